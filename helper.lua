@@ -9,11 +9,30 @@
 
 -- Allows you to adjust how many frames between each box being filled in
 local countdown_delay = 45
+-- and how long the boxes stay up after the good frame
+local countdown_hold = 180
 
 local goodframe_2_1 = 17821 -- 688 lag, 289 ingame clock, 18212 end of level lag frame
 local goodframe_2_2 = 19725 -- 773 lag, 285 ingame clock, 20207 end of level lag frame
 local goodframe_2_f = 22672 -- 872 lag, 277 ingame clock, 23079 end of level lag frame
 
+-- With the smb3rng module (make lua), the good frames come from the live
+-- Random_Pool and lag count instead of the constants above. The jump is
+-- this many frames before the end of level lag frame of the window.
+-- Only the level the runner is on is looked up, the route moves on to the
+-- next one on the end of level lag frame, see preframe_calculations().
+local route = {
+    { path = "2-1__1", eol_to_goodframe = 18212 - 17821 },
+    { path = "2-2__1", eol_to_goodframe = 20207 - 19725 },
+    { path = "2-f__1", eol_to_goodframe = 23079 - 22672 },
+}
+local route_step = 1
+local route_goodframe = nil     -- the good frame being counted down to
+local smb3rng_ok, smb3rng = pcall(require, "smb3rng")
+if not smb3rng_ok or not smb3rng.init() then
+    smb3rng = nil
+end
+
 local screen_width  = 0x10 --256 pixels, 16 blocks
 local screen_height = 0x0F --240 pixels, 15 blocks
 
@@ -52,7 +71,7 @@ function update_box_colors(frame, curr)
     -- Turn the middle box green on 'frame'
     -- First and last boxes are paired, and so on until the middle one
     -- Threshold for the first box is 'frame' - (floorhalf*countdown_delay)
-    if curr < (frame - (floorhalf*countdown_delay)) or curr > (frame + 180) then
+    if curr < (frame - (floorhalf*countdown_delay)) or curr > (frame + countdown_hold) then
         init_box_colors()
         return false
     end
@@ -65,9 +84,56 @@ function update_box_colors(frame, curr)
     return true
 end
 
+function live_goodframes()
+    local curr = emu.framecount()
+
+    -- A state loaded from before a level was left goes back to it
+    while route_step > 1 and curr < route[route_step - 1].left do
+        route_step = route_step - 1
+        route_goodframe = nil
+    end
+    if route_goodframe and curr < route_goodframe - (floorhalf*countdown_delay) then
+        route_goodframe = nil
+    end
+
+    local r = route[route_step]
+    if not r then
+        init_box_colors()
+        return
+    end
+    local frame = route_goodframe
+    if not frame then
+        -- Windows of 3 frames or more, 2 for the fort
+        local eol = smb3rng.next(r.path, memory.readbyterange(0x0781, 9), emu.lagcount(),
+                                 r.path == "2-f__1" and 2 or 3)
+        if not eol then
+            init_box_colors()
+            return
+        end
+        frame = eol - r.eol_to_goodframe
+    end
+
+    -- Stick to a window once it is counted down to, until it has passed
+    if update_box_colors(frame, curr) then
+        route_goodframe = frame
+    else
+        route_goodframe = nil
+    end
+end
+
+function route_level_ended(frame)
+    if route[route_step] then
+        route[route_step].left = frame
+        route_step = route_step + 1
+        route_goodframe = nil
+    end
+end
+
 function doit()
     curr = emu.framecount()
-    if update_box_colors(goodframe_2_1, curr) then
+    if smb3rng then
+        live_goodframes()
+    elseif update_box_colors(goodframe_2_1, curr) then
         -- do nothing
     elseif update_box_colors(goodframe_2_2, curr) then
         -- do nothing
@@ -112,6 +178,7 @@ function preframe_calculations()
         eol_frame = emu.framecount() - 1
         -- record frame when set back to 0
         print("EOL Frame: ", eol_frame)
+        route_level_ended(eol_frame)
         -- Death position return values are reset in this frame
         -- can we use them to determine what level we just finished?
     end
@@ -119,18 +186,13 @@ function preframe_calculations()
 
     -- EOL frame used: 3572
     if emu.framecount() == eol_frame + 29 then -- Determine facing (frame: 3600)
-      local bits = toBits(memory.readbyte(0x0784), 8)
-      local hleast = bits[7] 
-      local lleast = bits[8]
-      local least = (hleast * 2) + (lleast)
+      local least = memory.readbyte(0x0784) % 4
       print("Facing: ", table.concat(toBits(memory.readbyte(0x0784), 8)), " : ", get_direction(least))
     end
     if emu.framecount() == eol_frame + 29 + 39 then -- Determine move direction (frame: 3639)
-      local bits = toBits(memory.readbyte(0x0784), 8)
-      local hleast = bits[7] 
-      local lleast = bits[8]
-      local highest = bits[1]
-      local least = (hleast * 2) + (lleast)
+      local b = memory.readbyte(0x0784)
+      local least = b % 4
+      local highest = math.floor(b / 128)
       if highest == 0 then
         print("Moving: ", table.concat(toBits(memory.readbyte(0x0784), 8)), " : ", get_direction((least - 1) % 4))
       elseif highest == 1 then
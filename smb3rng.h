@@ -0,0 +1,88 @@
+#ifndef SMB3RNG_H
+#define SMB3RNG_H
+
+/**
+ * smb3rng: the smb3rngchk scanner as a library
+ *
+ * Build it with `make libsmb3rng.so`, or `make lua` for the Lua module used
+ * by helper.lua. After smb3rng_init(), every query is a hash lookup of the
+ * pool and a binary search of the path's windows, so it is cheap enough to
+ * run on every emulated frame.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Random_Pool in SMB3's RAM, 9 bytes
+#define SMB3RNG_POOL_ADDR   0x0781
+#define SMB3RNG_POOL_SIZE   9
+
+// The most windows smb3rng_next_windows() returns at once
+#define SMB3RNG_MAX_WINDOWS 256
+
+struct smb3rng_window {
+    int eol;            // end of level lag frame of the first good frame left
+    int len;            // good frames left in the window
+    int iteration;      // RNG iteration of the first good frame left
+};
+
+/**
+ * @brief Load the paths and precompute the windows of every path
+ *
+ * Only the first call does anything, later ones return 0 and keep the
+ * paths that were loaded.
+ *
+ * @param spec A spec file, see smb3rngchk -P, or NULL for the builtin paths
+ * @return 0 on success, -1 with the reason in smb3rng_error() otherwise
+ */
+int smb3rng_init(const char *spec);
+
+const char *smb3rng_error(void);
+
+int smb3rng_num_paths(void);
+
+/**
+ * @return The name of a path, or NULL if there is no such path
+ */
+const char *smb3rng_path_name(int path);
+
+/**
+ * @return The path with a name, or -1 if there is no such path
+ */
+int smb3rng_find_path(const char *name);
+
+/**
+ * @brief Find the RNG iteration of a live Random_Pool
+ *
+ * The same pool comes around again every 32767 iterations.
+ *
+ * @param pool The 9 bytes of Random_Pool
+ * @return The first iteration with the pool, or -1 if the RNG never reaches it
+ */
+int smb3rng_iteration(const uint8_t *pool);
+
+/**
+ * @brief Find the windows of a path from a live Random_Pool on
+ *
+ * A window the pool is already in counts with the good frames it has left.
+ *
+ * @param path The path
+ * @param pool The 9 bytes of Random_Pool
+ * @param lag Lag frames at the end of the level, or -1 for the path's own
+ * @param min_len Skip windows with fewer good frames left than this
+ * @param out Storage for the windows, in frame order
+ * @param max The size of out, only the first SMB3RNG_MAX_WINDOWS are found
+ *        with a larger one
+ * @return The number of windows, or -1 if the path or pool is not valid
+ */
+int smb3rng_next_windows(int path, const uint8_t *pool, int lag, int min_len,
+                         struct smb3rng_window *out, int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SMB3RNG_H */
@@ -0,0 +1,131 @@
+/**
+ * Lua binding of smb3rng.h, for FCEUX scripts
+ *
+ *   local smb3rng = require("smb3rng")
+ *   smb3rng.init([spec])                    -> true, or nil and the reason
+ *   smb3rng.paths()                         -> { name, ... }
+ *   smb3rng.iteration(pool)                 -> iteration, or nil
+ *   smb3rng.next(path, pool [, lag [, min_len [, count]]])
+ *                                           -> eol, len, eol, len, ...
+ *
+ * A pool is memory.readbyterange(0x0781, 9), or a table of the 9 bytes. A
+ * path is a name or its index from 1. The lag defaults to the path's own
+ * from the spec, and next() returns nothing when there is no window, so
+ * the per-frame calls don't allocate.
+ */
+#include <string.h>
+
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "smb3rng.h"
+
+// The most windows next() returns at once
+#define LUA_MAX_WINDOWS     16
+
+static void check_pool(lua_State *L, int arg, uint8_t *pool)
+{
+    if (lua_type(L, arg) == LUA_TSTRING) {
+        size_t len;
+        const char *s = lua_tolstring(L, arg, &len);
+        luaL_argcheck(L, len == SMB3RNG_POOL_SIZE, arg, "expected 9 bytes of Random_Pool");
+        memcpy(pool, s, SMB3RNG_POOL_SIZE);
+        return;
+    }
+    luaL_checktype(L, arg, LUA_TTABLE);
+    for (int i = 0; i < SMB3RNG_POOL_SIZE; i++) {
+        lua_rawgeti(L, arg, i + 1);
+        pool[i] = (uint8_t)luaL_checkinteger(L, -1);
+        lua_pop(L, 1);
+    }
+}
+
+static int check_path(lua_State *L, int arg)
+{
+    int path;
+
+    if (lua_type(L, arg) == LUA_TNUMBER) {
+        path = (int)lua_tointeger(L, arg) - 1;
+    } else {
+        path = smb3rng_find_path(luaL_checkstring(L, arg));
+    }
+    luaL_argcheck(L, smb3rng_path_name(path), arg, "no such path");
+    return path;
+}
+
+static int l_init(lua_State *L)
+{
+    if (smb3rng_init(luaL_optstring(L, 1, NULL)) < 0) {
+        lua_pushnil(L);
+        lua_pushstring(L, smb3rng_error());
+        return 2;
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+static int l_paths(lua_State *L)
+{
+    lua_createtable(L, smb3rng_num_paths(), 0);
+    for (int p = 0; p < smb3rng_num_paths(); p++) {
+        lua_pushstring(L, smb3rng_path_name(p));
+        lua_rawseti(L, -2, p + 1);
+    }
+    return 1;
+}
+
+static int l_iteration(lua_State *L)
+{
+    uint8_t pool[SMB3RNG_POOL_SIZE];
+    int iteration;
+
+    check_pool(L, 1, pool);
+    iteration = smb3rng_iteration(pool);
+    if (iteration < 0) {
+        return 0;
+    }
+    lua_pushinteger(L, iteration);
+    return 1;
+}
+
+static int l_next(lua_State *L)
+{
+    struct smb3rng_window w[LUA_MAX_WINDOWS];
+    uint8_t pool[SMB3RNG_POOL_SIZE];
+    int path = check_path(L, 1);
+    int lag = (int)luaL_optinteger(L, 3, -1);
+    int min_len = (int)luaL_optinteger(L, 4, 1);
+    int count = (int)luaL_optinteger(L, 5, 1);
+    int n;
+
+    check_pool(L, 2, pool);
+    luaL_argcheck(L, count >= 1 && count <= LUA_MAX_WINDOWS, 5, "count out of range");
+    n = smb3rng_next_windows(path, pool, lag, min_len, w, count);
+    if (n <= 0) {
+        return 0;
+    }
+    luaL_checkstack(L, 2 * n, NULL);
+    for (int i = 0; i < n; i++) {
+        lua_pushinteger(L, w[i].eol);
+        lua_pushinteger(L, w[i].len);
+    }
+    return 2 * n;
+}
+
+static const luaL_Reg smb3rng_funcs[] = {
+    { "init", l_init },
+    { "paths", l_paths },
+    { "iteration", l_iteration },
+    { "next", l_next },
+    { NULL, NULL },
+};
+
+int luaopen_smb3rng(lua_State *L)
+{
+#if LUA_VERSION_NUM >= 502
+    luaL_newlib(L, smb3rng_funcs);
+#else
+    luaL_register(L, "smb3rng", smb3rng_funcs);
+#endif
+    return 1;
+}
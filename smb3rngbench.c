@@ -0,0 +1,599 @@
+/**
+ * smb3rngbench: benchmarks of the smb3rngchk scanner
+ *
+ * smb3rngchk.c is built into the benchmarks, like the library builds it, so
+ * the static RNG, check and window functions are timed directly. Every
+ * allocation they make goes through the counters below.
+ *
+ * Results are one line per benchmark, tab separated, with a '#' header:
+ *
+ *   name  ops  ns_per_op  ops_per_sec  allocs  alloc_bytes
+ *
+ * An op is a tick for randomize, a jump of up to 2^20 ticks for
+ * randomize_n/jump, a check for the march and path benchmarks, a good frame
+ * for the window benchmark and a frame for the scans. A results file can be given back with -c to compare against it.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+static uint64_t Bench_Allocs;
+static uint64_t Bench_AllocBytes;
+
+static void Bench_Count(size_t n)
+{
+    __atomic_add_fetch(&Bench_Allocs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&Bench_AllocBytes, n, __ATOMIC_RELAXED);
+}
+
+static void *bench_malloc(size_t n)
+{
+    Bench_Count(n);
+    return malloc(n);
+}
+
+static void *bench_calloc(size_t n, size_t size)
+{
+    Bench_Count(n * size);
+    return calloc(n, size);
+}
+
+static void *bench_realloc(void *p, size_t n)
+{
+    Bench_Count(n);
+    return realloc(p, n);
+}
+
+static void *bench_aligned_alloc(size_t align, size_t n)
+{
+    Bench_Count(n);
+    return aligned_alloc(align, n);
+}
+
+#define malloc          bench_malloc
+#define calloc          bench_calloc
+#define realloc         bench_realloc
+#define aligned_alloc   bench_aligned_alloc
+
+#define SMB3RNG_LIBRARY
+#include "smb3rngchk.c"
+
+#undef malloc
+#undef calloc
+#undef realloc
+#undef aligned_alloc
+
+// The range the scan benchmarks cover, the default scan
+#define BENCH_START     2000
+#define BENCH_END       42767
+#define BENCH_FRAMES    (BENCH_END - BENCH_START)
+
+struct bench_result {
+    char name[64];
+    uint64_t ops;
+    double ns_per_op;
+    uint64_t allocs;
+    uint64_t alloc_bytes;
+};
+
+static struct bench_result *Bench_Results;
+static int Bench_NumResults;
+static int Bench_Repeats = 3;
+static const char *Bench_Filter;
+static uint8_t Bench_Pool[9];
+// Keeps the compiler from dropping the results of a benchmark
+static volatile uint64_t Bench_Sink;
+
+static double Bench_Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief Put the RNG and the windows back to how a scan starts
+ *
+ * @param frame The frame the scan starts at
+ * @return void
+ */
+static void Bench_Reset(int frame)
+{
+    memcpy(Random_Pool, Bench_Pool, sizeof(Random_Pool));
+    Randomize_N(frame - 13);
+    Windows_Free(&g_windows);
+    Windows_Init(&g_windows, false);
+}
+
+/**
+ * @brief Time a benchmark and record its result
+ *
+ * The benchmark runs Bench_Repeats times, and the fastest run counts. Its
+ * stdout goes to /dev/null, the scans print their fort windows.
+ *
+ * @param name The benchmark
+ * @param run Runs the benchmark once, and returns the ops it did
+ * @param arg Passed to run
+ * @return void
+ */
+static void Bench_Run(const char *name, uint64_t (*run)(void *), void *arg)
+{
+    struct bench_result *r;
+    int out = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    double best = 0;
+
+    if (Bench_Filter && !strstr(name, Bench_Filter)) {
+        return;
+    }
+    Bench_Results = realloc(Bench_Results, (Bench_NumResults + 1) * sizeof(*Bench_Results));
+    r = &Bench_Results[Bench_NumResults++];
+    memset(r, 0, sizeof(*r));
+    snprintf(r->name, sizeof(r->name), "%s", name);
+
+    fflush(stdout);
+    dup2(null, STDOUT_FILENO);
+    for (int k = 0; k < Bench_Repeats; k++) {
+        uint64_t allocs = Bench_Allocs, bytes = Bench_AllocBytes;
+        double t = Bench_Now();
+        uint64_t ops = run(arg);
+
+        t = Bench_Now() - t;
+        if (!k || t < best) {
+            best = t;
+        }
+        r->ops = ops;
+        r->allocs = Bench_Allocs - allocs;
+        r->alloc_bytes = Bench_AllocBytes - bytes;
+    }
+    fflush(stdout);
+    dup2(out, STDOUT_FILENO);
+    close(out);
+    close(null);
+    r->ns_per_op = r->ops? best / r->ops: 0;
+    fprintf(stderr, "%-24s %12.2f ns/op\n", r->name, r->ns_per_op);
+}
+
+static uint64_t Bench_Randomize(void *arg)
+{
+    const uint64_t ops = 10000000;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        Randomize();
+    }
+    Bench_Sink += Random_Pool[0];
+    return ops;
+}
+
+/**
+ * Randomize_N() jumps of random lengths, from 0 to 2^20 - 1 ticks
+ */
+static uint64_t Bench_Randomize_N(void *arg)
+{
+    const uint64_t ops = 100000;
+    uint64_t n = 12345;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        n = n * 6364136223846793005ULL + 1442695040888963407ULL;
+        Randomize_N(n >> 44);
+    }
+    Bench_Sink += Random_Pool[0];
+    return ops;
+}
+
+/**
+ * A tick, facing the first object of the first path, and its first move,
+ * so every check sees a new RandomN.
+ */
+static uint64_t Bench_MarchValidate(void *arg)
+{
+    const uint64_t ops = 10000000;
+    const struct move_info *mi = &Paths.move[Paths.move_first[Paths.obj_first[0]]];
+    int objid = Paths.objid[Paths.obj_first[0]];
+    uint64_t good = 0;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        Randomize();
+        Initialize_Map_Object_Data(Map_Object_Data, Random_Pool, objid);
+        good += Map_MarchValidateTravel(objid, *mi);
+    }
+    Bench_Sink += good;
+    return ops;
+}
+
+static uint64_t Bench_MarchLookup(void *arg)
+{
+    const uint64_t ops = 10000000;
+    const march_lut_t *lut = &Paths.lut[Paths.move_first[Paths.obj_first[0]]];
+    int objid = Paths.objid[Paths.obj_first[0]];
+    uint64_t good = 0;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        Randomize();
+        Initialize_Map_Object_Data(Map_Object_Data, Random_Pool, objid);
+        good += Map_MarchLookupTravel(objid, Map_Object_Data, Random_Pool, *lut);
+    }
+    Bench_Sink += good;
+    return ops;
+}
+
+/**
+ * Straight-line checks
+ *
+ * The scans check every path bit-sliced, so CheckGoodMovement() only runs in
+ * verbose mode, where it has to walk the path's plan to print each choice.
+ * These kernels measure what a per-frame check costs without the plan: the
+ * common path shapes, one or two objects with a fixed number of moves each
+ * after the level or fort face-to-move delay, are generated by
+ * CHECK_KERNEL(). Every loop of a kernel is unrolled: the ticks it reads are
+ * constants, the facings stay in registers as 2-bit direction codes, and each
+ * decision is a single table lookup. About half the frames pass each
+ * decision, so rather than branching on every one, a kernel ands them
+ * together and only bails out after the first step of a long path.
+ */
+typedef int64_t (*check_kernel_t)(const struct rng_ring *r, int64_t iteration, int p);
+
+static inline __attribute__((always_inline))
+int64_t Check_Unrolled(const struct rng_ring *r, int64_t iteration, int p,
+                       const int face2move, const int moves0, const int moves1)
+{
+    int o = Paths.obj_first[p];
+    const march_lut_t *lut0 = &Paths.lut[Paths.move_first[o]];
+    const march_lut_t *lut1 = &Paths.lut[Paths.move_first[o + !!moves1]];
+    int objid0 = Paths.objid[o], objid1 = Paths.objid[o + !!moves1];
+    const uint8_t *pool = RNG_Ring_Pool(r, iteration);
+    unsigned f0 = POOL_RANDOMN(pool, objid0) & 3;
+    unsigned f1 = POOL_RANDOMN(pool, objid1) & 3;
+    unsigned needed = MARCH_NEEDED;
+
+#pragma GCC unroll 16
+    for (int i = 0; i < max(moves0, moves1); i++) {
+        uint8_t d;
+
+        pool = RNG_Ring_Pool(r, iteration + face2move + NUM_FRAMES_FOR_ONE_MOVE * i);
+        if (i < moves0) {
+            d = lut0[i][f0 << 8 | POOL_RANDOMN(pool, objid0)];
+            needed &= d;
+            f0 = d & 3;
+        }
+        if (i < moves1) {
+            d = lut1[i][f1 << 8 | POOL_RANDOMN(pool, objid1)];
+            needed &= d;
+            f1 = d & 3;
+        }
+        if (i == 0 && max(moves0, moves1) > 2 && !(needed & MARCH_NEEDED)) {
+            return 0;
+        }
+    }
+    return (needed & MARCH_NEEDED)? Path_EOLFrame(p, iteration): 0;
+}
+
+#define CHECK_KERNEL(name, face2move, moves0, moves1)                               \
+    static int64_t Check_##name(const struct rng_ring *r, int64_t iteration, int p) \
+    {                                                                               \
+        return Check_Unrolled(r, iteration, p, face2move, moves0, moves1);          \
+    }
+
+// The shapes of the builtin paths and world2.spec
+CHECK_KERNEL(Level_2_1, LEVEL_FACE_TO_MOVE_FRAMES, 2, 1)
+CHECK_KERNEL(Fort_6_6, FORT_FACE_TO_MOVE_FRAMES, 6, 6)
+
+static const struct check_kernel {
+    int face_to_move_frames;
+    int moves[2];       // of the path's first and second object, 0 for none
+    check_kernel_t check;
+} CHECK_KERNELS[] = {
+    { LEVEL_FACE_TO_MOVE_FRAMES, { 2, 1 }, Check_Level_2_1 },
+    { FORT_FACE_TO_MOVE_FRAMES, { 6, 6 }, Check_Fort_6_6 },
+};
+
+/**
+ * @brief The kernel of a path's shape
+ *
+ * @param p The path
+ * @return The kernel, or NULL if there is none for the shape
+ */
+static check_kernel_t Check_FindKernel(int p)
+{
+    int o = Paths.obj_first[p];
+
+    if (Paths.obj_count[p] > 2) {
+        return NULL;
+    }
+    for (int k = 0; k < ARRAY_SIZE(CHECK_KERNELS); k++) {
+        const struct check_kernel *ck = &CHECK_KERNELS[k];
+
+        if (ck->face_to_move_frames == Paths.face_to_move_frames[Paths.level[p]] &&
+            ck->moves[0] == Paths.move_count[o] &&
+            ck->moves[1] == (Paths.obj_count[p] == 2? Paths.move_count[o + 1]: 0)) {
+            return ck->check;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * A path's check, CheckGoodMovement() or the kernel of its shape, and the
+ * good frames it found, so the two can be compared
+ */
+struct bench_check {
+    int p;
+    int64_t (*check)(const struct rng_ring *r, int64_t iteration, int p);
+    uint64_t good;
+};
+
+static uint64_t Bench_CheckPath(void *arg)
+{
+    static struct rng_ring ring;
+    struct bench_check *c = arg;
+    uint64_t good = 0;
+
+    Bench_Reset(BENCH_START);
+    RNG_Ring_Init(&ring, Random_Pool, BENCH_START);
+    for (int i = BENCH_START; i < BENCH_END; i++, RNG_Ring_Advance(&ring)) {
+        good += !!c->check(&ring, i, c->p);
+    }
+    Bench_Sink += good;
+    c->good = good;
+    return BENCH_FRAMES;
+}
+
+/**
+ * The good frames of a scan, to replay into the windows without checking
+ */
+struct bench_frames {
+    int *path;
+    int *eol;
+    int n;
+};
+
+static uint64_t Bench_UpdateWindows(void *arg)
+{
+    const struct bench_frames *f = arg;
+
+    Windows_Free(&g_windows);
+    Windows_Init(&g_windows, false);
+    for (int i = 0; i < f->n; i++) {
+        update_windows(&g_windows, f->path[i], f->eol[i], Bench_Pool);
+    }
+    return f->n;
+}
+
+static uint64_t Bench_ReferenceScan(void *arg)
+{
+    Bench_Reset(BENCH_START);
+    Reference_Scan(BENCH_START, BENCH_END);
+    return BENCH_FRAMES;
+}
+
+static uint64_t Bench_SlicedScan(void *arg)
+{
+    Bench_Reset(BENCH_START);
+    Sliced_Scan(&g_windows, Random_Pool, BENCH_START, BENCH_END);
+    return BENCH_FRAMES;
+}
+
+static uint64_t Bench_ParallelScan(void *arg)
+{
+    Bench_Reset(BENCH_START);
+    Parallel_Scan(BENCH_START, BENCH_END);
+    return BENCH_FRAMES;
+}
+
+static uint64_t Bench_Bitsets(void *arg)
+{
+    uint64_t **bits;
+
+    Bench_Reset(BENCH_START);
+    bits = Sliced_Bitsets(Random_Pool, BENCH_START, BENCH_END);
+    for (int p = 0; p < Paths.npaths; p++) {
+        Bench_Sink += bits[p][0];
+        free(bits[p]);
+    }
+    free(bits);
+    return BENCH_FRAMES;
+}
+
+/**
+ * The memoised checks, whether or not the scans would pick them
+ */
+static uint64_t Bench_MemoBitsets(void *arg)
+{
+    bool use = Memo_Use;
+    uint64_t n;
+
+    Memo_Use = true;
+    n = Bench_Bitsets(arg);
+    Memo_Use = use;
+    return n;
+}
+
+/**
+ * @brief Collect the good frames of every path over the benchmark range
+ */
+static void Bench_GoodFrames(struct bench_frames *f)
+{
+    uint64_t **bits;
+
+    memset(f, 0, sizeof(*f));
+    Bench_Reset(BENCH_START);
+    bits = Sliced_Bitsets(Random_Pool, BENCH_START, BENCH_END);
+    f->path = malloc(BENCH_FRAMES * Paths.npaths * sizeof(*f->path));
+    f->eol = malloc(BENCH_FRAMES * Paths.npaths * sizeof(*f->eol));
+    // In scan order, frame by frame and path by path
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        for (int p = 0; p < Paths.npaths; p++) {
+            if ((bits[p][i / 64] >> (i % 64)) & 1) {
+                f->path[f->n] = p;
+                f->eol[f->n++] = Path_EOLFrame(p, BENCH_START + i);
+            }
+        }
+    }
+    for (int p = 0; p < Paths.npaths; p++) {
+        free(bits[p]);
+    }
+    free(bits);
+}
+
+static void Bench_Write(FILE *f)
+{
+    fprintf(f, "# name\tops\tns_per_op\tops_per_sec\tallocs\talloc_bytes\n");
+    for (int i = 0; i < Bench_NumResults; i++) {
+        const struct bench_result *r = &Bench_Results[i];
+        fprintf(f, "%s\t%" PRIu64 "\t%.3f\t%.0f\t%" PRIu64 "\t%" PRIu64 "\n", r->name, r->ops,
+                r->ns_per_op, r->ns_per_op? 1e9 / r->ns_per_op: 0, r->allocs, r->alloc_bytes);
+    }
+}
+
+/**
+ * @brief Compare the results against a results file
+ *
+ * @param file The baseline results
+ * @param threshold The slowdown in percent that counts as a regression
+ * @return The number of regressions
+ */
+static int Bench_Compare(const char *file, double threshold)
+{
+    FILE *f = fopen(file, "r");
+    char buf[256];
+    int regressions = 0;
+
+    if (!f) {
+        fprintf(stderr, "Could not open %s: %s\n", file, strerror(errno));
+        exit(1);
+    }
+    printf("# name\tbaseline_ns_per_op\tns_per_op\tchange_percent\tallocs_change\n");
+    while (fgets(buf, sizeof(buf), f)) {
+        char name[64];
+        double ns;
+        uint64_t ops, allocs;
+
+        if (buf[0] == '#' || sscanf(buf, "%63s %" SCNu64 " %lf %*f %" SCNu64, name, &ops, &ns, &allocs) != 4) {
+            continue;
+        }
+        for (int i = 0; i < Bench_NumResults; i++) {
+            const struct bench_result *r = &Bench_Results[i];
+            double change;
+
+            if (strcmp(r->name, name)) {
+                continue;
+            }
+            change = ns? 100 * (r->ns_per_op - ns) / ns: 0;
+            printf("%s\t%.3f\t%.3f\t%+.1f\t%+" PRId64 "%s\n", name, ns, r->ns_per_op, change,
+                   (int64_t)(r->allocs - allocs), change > threshold? "\tREGRESSION": "");
+            regressions += change > threshold;
+        }
+    }
+    fclose(f);
+    return regressions;
+}
+
+static void bench_usage(char *prog)
+{
+    fprintf(stderr, "Usage: ./%s [-c baseline] [-f filter] [-j threads] [-o results] [-r repeats] [-s spec] [-t percent]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    const char *baseline = NULL, *results = NULL, *spec = NULL;
+    double threshold = 10;
+    struct bench_frames frames;
+    char name[64];
+    int opt;
+
+    g_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    while ((opt = getopt(argc, argv, "c:f:j:o:r:s:t:")) != -1) {
+        switch (opt) {
+        case 'c':
+            baseline = optarg;
+            break;
+        case 'f':
+            Bench_Filter = optarg;
+            break;
+        case 'j':
+            g_threads = atoi(optarg);
+            break;
+        case 'o':
+            results = optarg;
+            break;
+        case 'r':
+            Bench_Repeats = atoi(optarg);
+            break;
+        case 's':
+            spec = optarg;
+            break;
+        case 't':
+            threshold = atof(optarg);
+            break;
+        default:
+            bench_usage(argv[0]);
+            exit(1);
+        }
+    }
+    if (optind != argc || g_threads < 1 || Bench_Repeats < 1) {
+        bench_usage(argv[0]);
+        exit(1);
+    }
+
+    if (spec) {
+        Paths_Load(spec);
+    } else {
+        Paths_AddBuiltins();
+    }
+    RNG_InitJumps();
+    Compile_Paths();
+    Sliced_Init();
+    Memo_Init();
+    Windows_Init(&g_windows, false);
+    memcpy(Bench_Pool, Random_Pool, sizeof(Bench_Pool));
+    Bench_GoodFrames(&frames);
+
+    Bench_Run("randomize", Bench_Randomize, NULL);
+    Bench_Run("randomize_n/jump", Bench_Randomize_N, NULL);
+    Bench_Run("march_validate", Bench_MarchValidate, NULL);
+    Bench_Run("march_lookup", Bench_MarchLookup, NULL);
+    for (int p = 0; p < Paths.npaths; p++) {
+        struct bench_check c = { p, CheckGoodMovement, UINT64_MAX };
+        struct bench_check k = { p, Check_FindKernel(p), UINT64_MAX };
+
+        snprintf(name, sizeof(name), "check/%s", Paths.name[p]);
+        Bench_Run(name, Bench_CheckPath, &c);
+        if (!k.check) {
+            continue;
+        }
+        snprintf(name, sizeof(name), "check_unrolled/%s", Paths.name[p]);
+        Bench_Run(name, Bench_CheckPath, &k);
+        if (c.good != UINT64_MAX && k.good != UINT64_MAX && c.good != k.good) {
+            fprintf(stderr, "check_unrolled/%s found %" PRIu64 " good frames, check/%s %" PRIu64 "\n",
+                    Paths.name[p], k.good, Paths.name[p], c.good);
+            exit(1);
+        }
+    }
+    Bench_Run("update_windows", Bench_UpdateWindows, &frames);
+    Bench_Run("scan/reference", Bench_ReferenceScan, NULL);
+    Bench_Run("scan/sliced", Bench_SlicedScan, NULL);
+    if (g_threads > 1) {
+        Bench_Run("scan/parallel", Bench_ParallelScan, NULL);
+    }
+    Bench_Run("scan/bitsets", Bench_Bitsets, NULL);
+    if (Memo_All) {
+        Bench_Run("scan/memo", Bench_MemoBitsets, NULL);
+    }
+
+    if (results) {
+        FILE *f = fopen(results, "w");
+        if (!f) {
+            fprintf(stderr, "Could not write %s: %s\n", results, strerror(errno));
+            exit(1);
+        }
+        Bench_Write(f);
+        fclose(f);
+    } else if (!baseline) {
+        Bench_Write(stdout);
+    }
+    if (baseline) {
+        return Bench_Compare(baseline, threshold)? 2: 0;
+    }
+    return 0;
+}
@@ -5,12 +5,28 @@
 #include <string.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <signal.h>
+#include <time.h>
 
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
 #define max(a,b) \
     ({ __typeof__ (a) _a = (a); \
        __typeof__ (b) _b = (b); \
      _a > _b ? _a : _b; })
+#define min(a,b) \
+    ({ __typeof__ (a) _a = (a); \
+       __typeof__ (b) _b = (b); \
+     _a < _b ? _a : _b; })
 
 #define NUM_POWERUP_CLOUDS  61
 
@@ -35,6 +51,12 @@ static const char* const DIRSTRS[4] = {
 #define MUSIC_BOX   2   // music box is index 2
 #define HAMMER      3   // hammer is index 3
 
+/**
+ * Objects whose RandomN[] comes from Random_Pool[1..8], so a path can move
+ * objects 0 to 7
+ */
+#define NUM_OBJECTS 8
+
 /**
  * The number of frames between when a hammer brother decides which way
  * to face and then which way to move depends upon how much needs to happen
@@ -62,128 +84,302 @@ enum {
 };
 
 /**
- * Each of the following enums is used to describe a level and a "path"
- * for early hammer. Because the bros can move in multiple ways and still
- * get early hammer, each of these paths must be checked to find the best
- * windows overall.
+ * Each level has one or more "paths" for early hammer. Because the bros can
+ * move in multiple ways and still get early hammer, each of these paths must
+ * be checked to find the best windows overall.
  *
  * For example, the first path, "__1" defines the following:
- * LEVEL_2_1__1:
+ * 2-1__1:
  *      music box: RIGHT, UP                | hammer: UP
- * LEVEL_2_2__1:
+ * 2-2__1:
  *      music box: LEFT, RIGHT              | hammer: UP
- * LEVEL_2_F__1:
+ * 2-f__1:
  *      music box: LEFT, RIGHT, DOWN, LEFT  | hammer: LEFT, LEFT, DOWN, LEFT
  *
- * The fort levels are set up at the end so that we can log some windows
- * differently if we're looking at the fort versus a level.
+ * Windows are logged and counted differently for forts versus levels, see
+ * update_windows().
  */
 
-enum {
-    LEVEL_2_1__1,   /* __1 used for one early hammer set of bro movements */
-    LEVEL_2_2__1,
-    LEVEL_2_1__2,   /* __n used for different sets of bro movements */
-    LEVEL_2_2__2,
-    LEVEL_FORTS,
-    LEVEL_2_F__1,
-    LEVEL_2_F__3,
-    LEVEL_2_F__6,
-    MAX_LEVELS,
-};
-
-static const char* const LVLSTRS[MAX_LEVELS] = {
-    "Level 2-1__1",
-    "Level 2-2__1",
-    "Level 2-1__2",
-    "Level 2-2__2",
-    "LEVEL_FORTS, not a valid level enum",
-    "Level 2-f__1",
-    "Level 2-f__3",
-    "Level 2-f__6",
-};
-
 struct window_node {
-    struct window_node *next;
     int window_length;
-    int eol_frame;
+    int64_t eol_frame;
     uint8_t rng[9];
 };
 
 /**
- * These global arrays are used to keep track of the windows
+ * The windows of one path, kept in one growable array instead of a node
+ * per window. With a limit the array is a min-heap holding only the best
+ * `limit` windows, ranked by length and then by the earliest end of level
+ * frame, so memory stays flat however many frames are scanned. Either way
+ * the windows are in no particular order until Store_Sort().
+ *
+ * A window is added again every frame it grows by. Without a limit every
+ * length of it is kept, like the report lists them, but the heap keeps one
+ * record per window, so the top windows are that many different ones: a
+ * record that continues the last one added replaces it. Windows have to be
+ * added in frame order for that.
+ */
+struct window_store {
+    struct window_node *nodes;
+    int count;
+    int size;
+    int limit;      // 0 keeps every window
+    int stride;     // the path's, see PATH_STRIDE()
+    int last;       // with a limit, where the last window added is, -1 if it wasn't kept
+};
+
+/**
+ * The state used to keep track of the windows of one scan, with one entry
+ * per path. A serial scan uses g_windows directly, a parallel scan gives
+ * every shard its own and merges them into g_windows in frame order.
  */
-static struct window_node *max_windows[MAX_LEVELS];
-static int last_good[MAX_LEVELS];
-static int windowlen[MAX_LEVELS];
-static int windowmax[MAX_LEVELS];
-static int windowfrm[MAX_LEVELS];
+struct scan_windows {
+    struct window_store *windows;
+    int64_t *last_good;
+    int *windowlen;
+    int *windowmax;
+    int64_t *windowfrm;
+
+    /**
+     * Bookkeeping for merging shards: the run of good frames a path starts
+     * the scan with might continue a window from the previous shard, so its
+     * first frame, its length and the pools of its first two frames (which
+     * are below the window thresholds, so were never added) are kept, along
+     * with the best window after it. The windows of that run are kept in
+     * lead until the merge knows their real length.
+     */
+    int *hits;
+    int64_t *lead_eol;
+    int *lead_len;
+    uint8_t (*lead_rng)[2][9];
+    int *rest_max;
+    int64_t *rest_frm;
+    struct window_store *lead;
+
+    // A shard of a parallel scan, its fort windows are logged when merged
+    bool shard;
+
+    // A scan of a seed batch, see Seeds_Scan(), which logs no fort windows
+    bool quiet;
+
+    // Where Sliced_Scan() saves its success bitsets, see Bitsets_Open(), or NULL
+    FILE *bits_out;
+};
+
+static struct scan_windows g_windows;
 
 
 static bool g_verbose = false;
+static int g_threads = 1;
+static int g_top_windows = 0;
+static int g_routes = 0;
+static int g_stride = 0;        // -t, 0 for every path's own
+static int g_min_window = 0;    // -m, 0 for every path's own
 
+// How the report writes its windows, see Output_Window()
+enum output_format {
+    OUTPUT_TEXT,
+    OUTPUT_CSV,
+    OUTPUT_JSONL,
+    OUTPUT_BINARY,
+};
 
-#define free_max_windows(lvl)  \
-    do {                                            \
-        struct window_node *curr = max_windows[lvl];\
-        struct window_node *t;                      \
-        while (curr) {                              \
-            t = curr->next;                         \
-            free(curr);                             \
-            curr = t;                               \
-        }                                           \
-        max_windows[lvl] = NULL;                    \
-    } while (0)
+static enum output_format g_format = OUTPUT_TEXT;
+
+
+/**
+ * @brief Whether window a ranks below window b
+ */
+static inline bool Window_Worse(const struct window_node *a, const struct window_node *b)
+{
+    return a->window_length < b->window_length ||
+           (a->window_length == b->window_length && a->eol_frame > b->eol_frame);
+}
+
+/**
+ * @brief The end of level frame a window starts on, which tells windows apart
+ */
+static inline int64_t Store_Key(const struct window_store *st, const struct window_node *w)
+{
+    return w->eol_frame - (int64_t)(w->window_length - 1) * st->stride;
+}
+
+static inline void Store_Swap(struct window_store *st, int i, int j)
+{
+    struct window_node t = st->nodes[i];
+
+    st->nodes[i] = st->nodes[j];
+    st->nodes[j] = t;
+    st->last = (st->last == i)? j: (st->last == j)? i: st->last;
+}
+
+static void Store_SiftDown(struct window_store *st, int i)
+{
+    struct window_node *n = st->nodes;
+
+    for (;;) {
+        int c = 2 * i + 1;
+
+        if (c >= st->count) {
+            return;
+        }
+        if (c + 1 < st->count && Window_Worse(&n[c + 1], &n[c])) {
+            c++;
+        }
+        if (!Window_Worse(&n[c], &n[i])) {
+            return;
+        }
+        Store_Swap(st, i, c);
+        i = c;
+    }
+}
+
+/**
+ * @brief Add a window to a store
+ *
+ * @param st The store
+ * @param w The window
+ * @return void
+ */
+static void Store_Add(struct window_store *st, const struct window_node *w)
+{
+    struct window_node *n;
+    int i;
+
+    if (st->limit && st->last >= 0 && Store_Key(st, &st->nodes[st->last]) == Store_Key(st, w)) {
+        // The window grew, it only ranks higher
+        st->nodes[st->last] = *w;
+        Store_SiftDown(st, st->last);
+        return;
+    }
+    st->last = -1;
+    if (st->limit && st->count == st->limit) {
+        // Replace the worst window kept, if this one is better
+        if (Window_Worse(&st->nodes[0], w)) {
+            st->nodes[0] = *w;
+            st->last = 0;
+            Store_SiftDown(st, 0);
+        }
+        return;
+    }
+    if (st->count == st->size) {
+        st->size = st->size? st->size * 2: 64;
+        if (st->limit && st->size > st->limit) {
+            st->size = st->limit;
+        }
+        st->nodes = realloc(st->nodes, st->size * sizeof(*st->nodes));
+        if (!st->nodes) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+    n = st->nodes;
+    i = st->count++;
+    n[i] = *w;
+    if (st->limit) {
+        st->last = i;
+    }
+    while (st->limit && i > 0 && Window_Worse(&n[i], &n[(i - 1) / 2])) {
+        Store_Swap(st, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static int window_report_cmp(const void *a, const void *b)
+{
+    const struct window_node *x = a, *y = b;
+    if (x->window_length != y->window_length) {
+        return x->window_length - y->window_length;
+    }
+    return (x->eol_frame > y->eol_frame) - (x->eol_frame < y->eol_frame);
+}
+
+static int window_eol_cmp(const void *a, const void *b)
+{
+    const struct window_node *x = a, *y = b;
+    return (x->eol_frame > y->eol_frame) - (x->eol_frame < y->eol_frame);
+}
+
+/**
+ * @brief Sort a store for the report, by length and then end of level frame
+ *
+ * This breaks the heap, so nothing may be added to the store afterwards.
+ *
+ * @param st The store
+ * @return void
+ */
+static void Store_Sort(struct window_store *st)
+{
+    qsort(st->nodes, st->count, sizeof(*st->nodes), window_report_cmp);
+}
+
+static void Store_Free(struct window_store *st)
+{
+    free(st->nodes);
+    *st = (struct window_store) { .limit = st->limit, .stride = st->stride, .last = -1 };
+}
 
-#define add_window(lvl, len, eol) \
+/**
+ * Windows of the leading run of a shard go to its lead store, see
+ * Merge_Windows()
+ */
+#define add_window(ws, lvl, len, eol, pool) \
     do {                                            \
-        struct window_node *last = max_windows[lvl];\
-        struct window_node *w;                      \
-        while (last && last->next) {                \
-            last = last->next;                      \
-        }                                           \
-        w = calloc(1, sizeof(struct window_node));  \
-        *w = (struct window_node) {                 \
+        struct window_node w = {                    \
             .window_length = len,                   \
             .eol_frame = eol,                       \
         };                                          \
-        memcpy(w->rng, Random_Pool, sizeof(w->rng));\
-        if (last) {                                 \
-            last->next = w;                         \
+        memcpy(w.rng, pool, sizeof(w.rng));         \
+        if ((ws)->shard && (ws)->windowlen[lvl] == (ws)->hits[lvl] + 1) { \
+            Store_Add(&(ws)->lead[lvl], &w);        \
         } else {                                    \
-            max_windows[lvl] = w;                   \
+            Store_Add(&(ws)->windows[lvl], &w);     \
         }                                           \
     } while (0)
 
 /**
  * This macro checks to see if we're in a window of good frames, then
- * updates the stats accordingly.
+ * updates the stats accordingly. pool is the Random_Pool of the frame
+ * that was checked.
+ *
+ * Good frames for a fort are counted every other frame, and windows are
+ * recorded from 2 frames for forts and from 3 frames for other levels, see
+ * PATH_STRIDE() and PATH_MIN_WINDOW().
  */
-#define update_windows(lvlenum, eolfrm) \
+#define update_windows(ws, path, eolfrm, pool) \
     do {                                                                                    \
-        int l = lvlenum;                                                                    \
+        struct scan_windows *s = ws;                                                        \
+        int l = path;                                                                       \
+        bool fort = PATH_FORT(l);                                                           \
         if (g_verbose) {                                                                    \
-            printf("        %s SUCCESS ON end of level FRAME %d\n", LVLSTRS[lvlenum], eolfrm);    \
+            printf("        Level %s SUCCESS ON end of level FRAME %" PRId64 "\n", Paths.name[l], (int64_t)(eolfrm));  \
         }                                                                                   \
-        windowlen[l] = (l > LEVEL_FORTS)? ((last_good[l] == (eolfrm - 2))? windowlen[l] + 1: 1): ((last_good[l] == (eolfrm - 1))? windowlen[l] + 1: 1); \
-        /*if (windowlen[l] > windowmax[l]) {*/                                              \
-        /*    free_max_windows(l);*/                                                        \
-        /*}*/                                                                               \
-        /*if (windowlen[l] >= windowmax[l]) {*/                                             \
-        if (windowlen[l] > 2 && l < LEVEL_FORTS) {                                          \
-            /*printf("adding window of length %d for level %s: %d\n", windowlen[l], LVLSTRS[l], eolfrm);*/  \
-            add_window(l, windowlen[l], eolfrm);                                            \
-        } else if (windowlen[l] > 1 && l > LEVEL_FORTS) {                                   \
-            printf("adding window of length %d for level %s: %d\n", windowlen[l], LVLSTRS[l], eolfrm);  \
-            add_window(l, windowlen[l], eolfrm);                                            \
+        s->windowlen[l] = (s->last_good[l] == (eolfrm) - PATH_STRIDE(l))? s->windowlen[l] + 1: 1; \
+        if (s->windowlen[l] >= PATH_MIN_WINDOW(l)) {                                        \
+            if (fort && !s->shard) {                                                        \
+                printf("adding window of length %d for level Level %s: %" PRId64 "\n", s->windowlen[l], Paths.name[l], (int64_t)(eolfrm));  \
+            }                                                                               \
+            add_window(s, l, s->windowlen[l], eolfrm, pool);                                \
         }                                                                                   \
-        if (windowlen[l] > windowmax[l]) {                                                  \
-            windowmax[l] = windowlen[l];                                                    \
-            windowfrm[l] = eolfrm;                                                          \
+        if (s->windowlen[l] > s->windowmax[l]) {                                            \
+            s->windowmax[l] = s->windowlen[l];                                              \
+            s->windowfrm[l] = eolfrm;                                                       \
+        }                                                                                   \
+        s->last_good[l] = eolfrm;                                                           \
+        if (++s->hits[l] == 1) {                                                            \
+            s->lead_eol[l] = eolfrm;                                                        \
+        }                                                                                   \
+        if (s->windowlen[l] == s->hits[l]) {                                                \
+            s->lead_len[l] = s->hits[l];                                                    \
+            if (s->hits[l] <= 2) {                                                          \
+                memcpy(s->lead_rng[l][s->hits[l] - 1], pool, 9);                            \
+            }                                                                               \
+        } else if (s->windowlen[l] > s->rest_max[l]) {                                      \
+            s->rest_max[l] = s->windowlen[l];                                               \
+            s->rest_frm[l] = eolfrm;                                                        \
         }                                                                                   \
-        last_good[l] = eolfrm;                                                              \
     } while (0)
 
-
 /**
  * This structure is used to define the desired results of a
  * hammer brother movement decision. The above enums should be
@@ -209,6 +405,23 @@ struct move_info {
     int dir[4];
 };
 
+/**
+ * A move_info compiled by Compile_Movement(). The march decision only
+ * depends on the facing and the RandomN byte, so every move is compiled into
+ * a table indexed by facing << 8 | RandomN[objid]. Each entry holds the
+ * chosen direction in the low two bits, MARCH_MOVED if a direction was chosen
+ * at all, MARCH_NEEDED if it was the DIRECTION_NEEDED one and MARCH_RETRIED
+ * if a DIRECTION_INVALID direction made the object choose again.
+ */
+#define MARCH_LUT_SIZE  1024
+#define MARCH_MOVED     0x04
+#define MARCH_NEEDED    0x08
+#define MARCH_RETRIED   0x10
+typedef uint8_t march_lut_t[MARCH_LUT_SIZE];
+
+/**
+ * The builtin paths are defined as movements, see CHECK_DEFINE()
+ */
 struct movement {
     int lag_frames;
     int eol_to_init_frames;
@@ -219,6 +432,133 @@ struct movement {
     struct move_info *h_move_array;
 };
 
+/**
+ * Every path that is checked is compiled into one flat table, either from
+ * the builtin CHECK_DEFINE() movements or from a spec file loaded at startup
+ * (see Paths_Load()). The table is a struct of arrays: everything per level,
+ * per path, per object of a path and per move has its own contiguous array,
+ * and the objects and moves of a path are ranges in the object and move
+ * arrays. Paths are checked and reported in the order they were defined.
+ *
+ * A route is a sequence of paths, one per level, that are played one after
+ * the other, along with the minimum frames between the end of level lag
+ * frames of consecutive paths. See Route_Optimize().
+ */
+struct path_table {
+    int nlevels;
+    char **level_name;
+    int *lag_frames;
+    int *eol_to_init_frames;
+    int *face_to_move_frames;
+    bool *fort;
+
+    int npaths;
+    char **name;
+    int *level;
+    int *obj_first;
+    int *obj_count;
+
+    int nobjs;
+    int *objid;
+    int *move_first;
+    int *move_count;
+
+    int nmoves;
+    struct move_info *move;
+    march_lut_t *lut;
+
+    // Every path's decisions in the order CheckGoodMovement() makes them,
+    // step by step and the path's objects in turn within a step
+    int *plan_first;        // per path, npaths + 1 of them
+    uint8_t *plan_objid;
+    int *plan_move;         // into move and lut
+    int *plan_tick;         // ticks after the checked frame
+
+    int nroutes;
+    char **route_name;
+    int *route_first;
+    int *route_count;
+
+    int nsteps;
+    int *step_path;
+    int *step_gap;          // minimum frames after the previous step's EOL frame
+
+    // The order the bit-sliced checks decide each path's moves in, see
+    // Order_Checks(), NULL for the default order
+    int *order_first;       // per path, into order_obj and order_move
+    int *order_obj;         // the object, in the objects table
+    int *order_move;        // the object's move index
+};
+
+static struct path_table Paths;
+
+#define PATH_FORT(p)    (Paths.fort[Paths.level[p]])
+
+/**
+ * Good frames of a fort are counted every other frame, and its windows
+ * start at 2 good frames, those of other levels at 3. -t and -m override
+ * them for every path.
+ */
+#define PATH_STRIDE(p)      (g_stride? g_stride: PATH_FORT(p)? 2: 1)
+#define PATH_MIN_WINDOW(p)  (g_min_window? g_min_window: PATH_FORT(p)? 2: 3)
+
+/**
+ * @brief Allocate the window state of a scan for every path
+ *
+ * Every path keeps the best g_top_windows windows, or all of them if that
+ * is 0.
+ *
+ * @param ws The window state
+ * @param shard Whether the scan is a shard of a parallel scan
+ * @return void
+ */
+static void Windows_Init(struct scan_windows *ws, bool shard)
+{
+    int n = Paths.npaths;
+
+    *ws = (struct scan_windows) {
+        .windows = calloc(n, sizeof(*ws->windows)),
+        .last_good = calloc(n, sizeof(int64_t)),
+        .windowlen = calloc(n, sizeof(int)),
+        .windowmax = calloc(n, sizeof(int)),
+        .windowfrm = calloc(n, sizeof(int64_t)),
+        .hits = calloc(n, sizeof(int)),
+        .lead_eol = calloc(n, sizeof(int64_t)),
+        .lead_len = calloc(n, sizeof(int)),
+        .lead_rng = calloc(n, sizeof(*ws->lead_rng)),
+        .rest_max = calloc(n, sizeof(int)),
+        .rest_frm = calloc(n, sizeof(int64_t)),
+        .lead = calloc(n, sizeof(*ws->lead)),
+        .shard = shard,
+    };
+    for (int l = 0; l < n; l++) {
+        // A shard logs every fort window when it is merged, so keeps them all
+        ws->windows[l].limit = (shard && PATH_FORT(l))? 0: g_top_windows;
+        ws->windows[l].stride = ws->lead[l].stride = PATH_STRIDE(l);
+        ws->windows[l].last = ws->lead[l].last = -1;
+    }
+}
+
+static void Windows_Free(struct scan_windows *ws)
+{
+    for (int l = 0; l < Paths.npaths; l++) {
+        Store_Free(&ws->windows[l]);
+        Store_Free(&ws->lead[l]);
+    }
+    free(ws->windows);
+    free(ws->lead);
+    free(ws->last_good);
+    free(ws->windowlen);
+    free(ws->windowmax);
+    free(ws->windowfrm);
+    free(ws->hits);
+    free(ws->lead_eol);
+    free(ws->lead_len);
+    free(ws->lead_rng);
+    free(ws->rest_max);
+    free(ws->rest_frm);
+}
+
 /**
  * Temporary storage variables found in Mario Bros 3 at
  * memory addresses 0x0, 0x1, and 0xC, respectively
@@ -239,12 +579,6 @@ static uint8_t Map_Object_Data[15];
  */
 static uint8_t Random_Pool[9] = { 0x88, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
 
-/**
- * This backup is used for restoring the last position at which
- * movements were begun to be checked.
- */
-static uint8_t Random_Pool_backup[9];
-
 /**
  * RandomN is the value most of the code uses or indexes off of.
  * It is the second byte in the array.
@@ -252,106 +586,325 @@ static uint8_t Random_Pool_backup[9];
 static uint8_t *RandomN = &Random_Pool[1];
 
 /**
- * @brief Save off the Random_Pool array to the backup copy
+ * The pool in machine words: Random_Pool is the 72-bit big-endian number
+ * hi:lo, so hi is Random_Pool[0] and lo holds Random_Pool[1] (RandomN) in
+ * its top byte down to Random_Pool[8] in its bottom byte. Bit b of the
+ * number is bit b % 8 of Random_Pool[8 - b / 8].
  *
- * @return void
+ * A tick of the game's byte loop is then a right shift of the number by
+ * one, with bit 1 of Random_Pool[0] ^ bit 1 of Random_Pool[1] (bits 65 and
+ * 57) shifted in at the top.
+ */
+struct rng_state {
+    uint64_t lo;        // Random_Pool[1..8]
+    uint8_t hi;         // Random_Pool[0]
+};
+
+/**
+ * @brief The state of a pool in the game's byte layout
  */
-static void SnapshotRNG(void)
+static inline struct rng_state RNG_Load(const uint8_t *pool)
 {
-    int i;
-    for (i = 0; i < ARRAY_SIZE(Random_Pool); i++) {
-        Random_Pool_backup[i] = Random_Pool[i];
-    }
+    struct rng_state s = { .hi = pool[0] };
+
+    memcpy(&s.lo, pool + 1, sizeof(s.lo));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    s.lo = __builtin_bswap64(s.lo);
+#endif
+    return s;
 }
 
 /**
- * @brief Restore the Random_Pool array from the backup copy
+ * @brief Write a state back out in the game's byte layout
  *
+ * @param s The state
+ * @param pool Storage for the 9 bytes of Random_Pool
  * @return void
  */
-static void RestoreRNG(void)
+static inline void RNG_Store(struct rng_state s, uint8_t *pool)
 {
-    int i;
-    for (i = 0; i < ARRAY_SIZE(Random_Pool); i++) {
-        Random_Pool[i] = Random_Pool_backup[i];
-    }
+    pool[0] = s.hi;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    s.lo = __builtin_bswap64(s.lo);
+#endif
+    memcpy(pool + 1, &s.lo, sizeof(s.lo));
 }
 
 /**
- * @brief Tick the random number array one time.
+ * @brief Tick a state one time
+ */
+static inline struct rng_state RNG_Tick(struct rng_state s)
+{
+    uint8_t carry = ((s.hi ^ s.lo >> 56) >> 1) & 1;
+
+    s.lo = s.lo >> 1 | (uint64_t)(s.hi & 1) << 63;
+    s.hi = carry << 7 | s.hi >> 1;
+    return s;
+}
+
+/**
+ * @brief Tick a state eight times
+ *
+ * Eight ticks move every byte of the pool one place along, so only the new
+ * Random_Pool[0] has to be worked out. Its bit j is the carry of tick j,
+ * which is bit 65 + j ^ bit 57 + j of the old number for the first seven
+ * ticks, and for the last one bit 64 ^ the carry of the first tick, which
+ * has been shifted down to bit 65 by then.
+ */
+static inline struct rng_state RNG_Tick8(struct rng_state s)
+{
+    unsigned b = (unsigned)s.hi << 7 | s.lo >> 57;     // bits 57..71
+    unsigned f = (b ^ b >> 8) & 0x7f;
+
+    f |= ((f ^ b >> 7) & 1) << 7;
+    s.lo = s.lo >> 8 | (uint64_t)s.hi << 56;
+    s.hi = f;
+    return s;
+}
+
+/**
+ * @brief Tick a random number array one time.
  *
  * This shifts the entire array of random numbers by one bit.
  *
+ * @param pool The 9 byte random number array to tick
+ * @return void
+ */
+static void Randomize_Pool(uint8_t *pool)
+{
+    RNG_Store(RNG_Tick(RNG_Load(pool)), pool);
+}
+
+/**
+ * @brief Tick the random number array one time.
+ *
  * @return void
  */
 static void Randomize(void)
 {
-    uint8_t Temp_Var1 = Random_Pool[0] & 0x2;
-    uint8_t carry = !!((Random_Pool[1] & 0x2) ^ Temp_Var1);
+    Randomize_Pool(Random_Pool);
+}
 
-    for (int i = 0; i < sizeof(Random_Pool)/sizeof(Random_Pool[0]); i++) {
-        /**
-         * Carry is shifted into the most-significant bit.
-         * Least-significant bit is saved off into carry.
-         */
-        uint8_t b = Random_Pool[i] & 1;
-        Random_Pool[i] = (carry << 7) | (Random_Pool[i] >> 1);
-        carry = b;
+/**
+ * Randomize() is linear over GF(2), so advancing the 72-bit Random_Pool by
+ * n ticks is a multiplication by the n-th power of its transition matrix M.
+ *
+ * RNG_Jump_Pow[k] holds M^(2^k) as 72 columns: column b is the state that
+ * results from ticking a state with only bit b set 2^k times. Any n is then
+ * at most 64 matrix-vector products, which beats ticking a byte at a time
+ * from RNG_JUMP_TICKS ticks on.
+ */
+#define RNG_BITS            72
+#define RNG_JUMP_POWERS     64
+#define RNG_JUMP_TICKS      1024
+static struct rng_state RNG_Jump_Pow[RNG_JUMP_POWERS][RNG_BITS];
+
+/**
+ * @brief Multiply a state by a matrix stored as columns
+ *
+ * @param cols The 72 columns of the matrix
+ * @param in The state to multiply
+ * @return The product
+ */
+static struct rng_state RNG_MatVec(const struct rng_state cols[RNG_BITS], struct rng_state in)
+{
+    struct rng_state out = { 0 };
+
+    for (uint64_t m = in.lo; m; m &= m - 1) {
+        const struct rng_state *c = &cols[__builtin_ctzll(m)];
+        out.lo ^= c->lo;
+        out.hi ^= c->hi;
     }
+    for (unsigned m = in.hi; m; m &= m - 1) {
+        const struct rng_state *c = &cols[64 + __builtin_ctz(m)];
+        out.lo ^= c->lo;
+        out.hi ^= c->hi;
+    }
+    return out;
 }
 
 /**
- * @brief Tick the random number array n times.
+ * @brief Build the transition matrix powers
+ *
+ * Must be called once before Randomize_Pool_N() jumps.
+ *
+ * @return void
+ */
+static void RNG_InitJumps(void)
+{
+    uint8_t saved[9];
+    memcpy(saved, Random_Pool, sizeof(saved));
+
+    // M^1, one column at a time, straight from Randomize()
+    for (int b = 0; b < RNG_BITS; b++) {
+        memset(Random_Pool, 0, sizeof(Random_Pool));
+        Random_Pool[8 - b / 8] = 1 << (b % 8);
+        Randomize();
+        RNG_Jump_Pow[0][b] = RNG_Load(Random_Pool);
+    }
+    memcpy(Random_Pool, saved, sizeof(saved));
+
+    // M^(2^(k+1)) = M^(2^k) * M^(2^k)
+    for (int k = 1; k < RNG_JUMP_POWERS; k++) {
+        for (int b = 0; b < RNG_BITS; b++) {
+            RNG_Jump_Pow[k][b] = RNG_MatVec(RNG_Jump_Pow[k - 1], RNG_Jump_Pow[k - 1][b]);
+        }
+    }
+}
+
+/**
+ * @brief Tick a state n times
+ *
+ * Counts below RNG_JUMP_TICKS go a byte at a time, so the fixed per-check
+ * advances (32, 39 and 102 ticks) are a few RNG_Tick8() each, and anything
+ * longer is done in O(log n) with the transition matrix powers.
+ *
+ * @param s The state
+ * @param n The number of positions to shift the LFSR
+ * @return The state n ticks later
+ */
+static inline struct rng_state RNG_Advance(struct rng_state s, uint64_t n)
+{
+    if (n >= RNG_JUMP_TICKS) {
+        for (int k = 0; n; k++, n >>= 1) {
+            if (n & 1) {
+                s = RNG_MatVec(RNG_Jump_Pow[k], s);
+            }
+        }
+        return s;
+    }
+    for (; n >= 8; n -= 8) {
+        s = RNG_Tick8(s);
+    }
+    for (; n; n--) {
+        s = RNG_Tick(s);
+    }
+    return s;
+}
+
+/**
+ * @brief Tick a random number array n times.
  *
  * This shifts the entire array of random numbers by n bits.
  *
+ * @param pool The 9 byte random number array to tick
+ * @param n The number of positions to shift the LFSR
+ * @return void
+ */
+static void Randomize_Pool_N(uint8_t *pool, uint64_t n)
+{
+    RNG_Store(RNG_Advance(RNG_Load(pool), n), pool);
+}
+
+/**
+ * @brief Tick the random number array n times.
+ *
  * @param n The number of positions to shift the LFSR
  * @return void
  */
 static void Randomize_N(uint64_t n)
 {
-    uint64_t i;
-    for (i = 0; i < n; i++) {
-        Randomize();
-    }
+    Randomize_Pool_N(Random_Pool, n);
 }
 
 /**
- * @brief Initialize the global Map_Object_Data value for specified index
+ * RandomN of a pool other than the global Random_Pool
+ */
+#define POOL_RANDOMN(pool, objid)   ((pool)[1 + (objid)])
+
+/**
+ * @brief Initialize a Map_Object_Data value for specified index
  *
  * This function is called after the level is ended to decide which direction
  * the hammer brother will face. It is 39 frames prior to the hammer brother
  * deciding which direction it travels.
  *
+ * @param data The Map_Object_Data array to initialize
+ * @param pool The Random_Pool of the frame the level ended on
  * @param index The object's index for which the Map_Object_Data is to be set
  * @return void
  */
-static void Initialize_Map_Object_Data(int index)
+static void Initialize_Map_Object_Data(uint8_t *data, const uint8_t *pool, int index)
 {
-    Map_Object_Data[index] = RandomN[index] & 3;
+    data[index] = POOL_RANDOMN(pool, index) & 3;
 }
 
+/**
+ * The checks for a frame look at the pools up to Check_Ticks ticks after it.
+ * Rather than replaying those ticks for every path, scans keep the pools of
+ * the upcoming frames in a ring buffer that is filled once as the scan
+ * advances, and the checks just read the pools at fixed offsets.
+ */
+#define RNG_RING_SIZE   512
+
+struct rng_ring {
+    uint8_t pools[RNG_RING_SIZE][9];
+    struct rng_state state;     // the last pool that was generated
+    int64_t next;       // the frame of the next pool to generate
+};
 
 /**
- * @brief Implements the march direction logic for the Bros.
+ * @brief Generate the pool of the next frame into the ring, replacing the
+ * oldest one
  *
- * This function was implemented to mirror the logic in the assembly.
- * If there is some major logic weirdness or unoptimal loops or checks,
- * that is why.
+ * @param r The ring
+ * @return void
+ */
+static void RNG_Ring_Advance(struct rng_ring *r)
+{
+    r->state = RNG_Tick(r->state);
+    RNG_Store(r->state, r->pools[r->next & (RNG_RING_SIZE - 1)]);
+    r->next++;
+}
+
+/**
+ * @brief Fill a ring with the pools of frame to frame + RNG_RING_SIZE - 1
  *
- * @param objid The object ID for which to perform direction logic
+ * @param r The ring
+ * @param pool The Random_Pool one tick before frame
+ * @param frame The first frame in the ring
+ * @return void
+ */
+static void RNG_Ring_Init(struct rng_ring *r, const uint8_t *pool, int64_t frame)
+{
+    r->state = RNG_Load(pool);
+    r->next = frame;
+    for (int k = 0; k < RNG_RING_SIZE; k++) {
+        RNG_Ring_Advance(r);
+    }
+}
+
+/**
+ * @brief The pool of a frame, which must be one of the last RNG_RING_SIZE
+ * frames generated
+ */
+static inline const uint8_t *RNG_Ring_Pool(const struct rng_ring *r, int64_t frame)
+{
+    return r->pools[frame & (RNG_RING_SIZE - 1)];
+}
+
+
+/**
+ * @brief The march direction decision behind Map_MarchValidateTravel
+ *
+ * This is the same logic without touching any global state, so that it can
+ * also be used to precompute decisions for every facing/random combination.
+ *
+ * @param facing The direction the object is currently facing
+ * @param random The object's RandomN byte
  * @param dirs A move_info struct representing whether each direction
  *        for a movement is valid, desired, or a failure.
+ * @param chosen Set to the direction that was chosen, or -1 if the object
+ *        was not able to move in any direction
  *
- * @return bool indicating whether or not the specified objid chose
- *         the DIRECTION_NEEDED direction.
+ * @return bool indicating whether or not the DIRECTION_NEEDED direction
+ *         was chosen.
  */
-bool Map_MarchValidateTravel(uint8_t objid, struct move_info dirs)
+static bool March_Decide(uint8_t facing, uint8_t random, const struct move_info *dirs, int *chosen)
 {
     int8_t tries = 4; // 4 directions
-    uint8_t facing = Map_Object_Data[objid];
-    uint8_t direction = RandomN[objid] & 0x3;
-    uint8_t increment = (RandomN[objid] & 0x80)? 1: -1;
+    uint8_t direction = random & 0x3;
+    uint8_t increment = (random & 0x80)? 1: -1;
 
     while (tries > 0) {
         direction += increment;
@@ -379,20 +932,15 @@ bool Map_MarchValidateTravel(uint8_t objid, struct move_info dirs)
         }
 
         /* validate travel direction */
-        if (dirs.dir[direction] == DIRECTION_FAIL) {
-            if (g_verbose) {
-                printf("        %s: chose %s\n", objid==HAMMER?"HAMMER":"MUSIC BOX", DIRSTRS[direction]);
-            }
+        if (dirs->dir[direction] == DIRECTION_FAIL) {
+            *chosen = direction;
             return false;
         }
-        if (dirs.dir[direction] == DIRECTION_INVALID) {
+        if (dirs->dir[direction] == DIRECTION_INVALID) {
             continue;
         }
         /* Chose the needed direction */
-        if (g_verbose) {
-            printf("        %s: chose %s\n", objid==HAMMER?"HAMMER":"MUSIC BOX", DIRSTRS[direction]);
-        }
-        Map_Object_Data[objid] = direction;
+        *chosen = direction;
         return true;
     }
 
@@ -401,32 +949,274 @@ bool Map_MarchValidateTravel(uint8_t objid, struct move_info dirs)
      * it is not allowed to move. In this case, the game sets
      * its marching frames to 0 so it doesn't do any more logic.
      */
+    *chosen = -1;
     return false;
 }
 
-static void usage(char *prog)
-{
-    fprintf(stderr, "Usage: ./%s [start_iteration] [verbose]\n", prog);
+/**
+ * @brief The name of an object in verbose output
+ *
+ * @param objid The object ID
+ * @return The name
+ */
+static const char *Object_Name(int objid)
+{
+    static const char *const names[NUM_OBJECTS] = {
+        "OBJECT 0", "OBJECT 1", "MUSIC BOX", "HAMMER",
+        "OBJECT 4", "OBJECT 5", "OBJECT 6", "OBJECT 7",
+    };
+    return names[objid];
+}
+
+/**
+ * @brief Implements the march direction logic for the Bros.
+ *
+ * This function was implemented to mirror the logic in the assembly.
+ * If there is some major logic weirdness or unoptimal loops or checks,
+ * that is why.
+ *
+ * @param objid The object ID for which to perform direction logic
+ * @param dirs A move_info struct representing whether each direction
+ *        for a movement is valid, desired, or a failure.
+ *
+ * @return bool indicating whether or not the specified objid chose
+ *         the DIRECTION_NEEDED direction.
+ */
+bool Map_MarchValidateTravel(uint8_t objid, struct move_info dirs)
+{
+    int direction;
+    bool success = March_Decide(Map_Object_Data[objid], RandomN[objid], &dirs, &direction);
+
+    if (direction >= 0 && g_verbose) {
+        printf("        %s: chose %s\n", Object_Name(objid), DIRSTRS[direction]);
+    }
+    if (success) {
+        Map_Object_Data[objid] = direction;
+    }
+    return success;
+}
+
+/**
+ * @brief Whether a march decision chose again after a DIRECTION_INVALID
+ *
+ * The first direction tried is the one after random's, skipping the one
+ * opposite the facing, and a FAIL or NEEDED direction is taken right away,
+ * so the decision retried if it ended up anywhere else.
+ *
+ * @param facing The direction the object was facing
+ * @param random The object's RandomN byte
+ * @param chosen The direction March_Decide() chose
+ * @return bool
+ */
+static bool March_Retried(uint8_t facing, uint8_t random, int chosen)
+{
+    uint8_t increment = (random & 0x80)? 1: -1;
+    uint8_t first = (random + increment) & 3;
+
+    if ((facing ^ first) == 1) {
+        first = (first + increment) & 3;
+    }
+    return chosen != first;
+}
+
+/**
+ * @brief Compile a list of moves into march decision tables
+ *
+ * @param moves The number of moves
+ * @param move_array The moves to compile
+ * @return The tables, one per move
+ */
+static march_lut_t *Compile_Moves(int moves, const struct move_info *move_array)
+{
+    march_lut_t *luts = calloc(moves, sizeof(march_lut_t));
+
+    for (int i = 0; i < moves; i++) {
+        for (int idx = 0; idx < MARCH_LUT_SIZE; idx++) {
+            int direction;
+            bool success = March_Decide(idx >> 8, idx & 0xff, &move_array[i], &direction);
+            if (direction >= 0) {
+                luts[i][idx] = direction | MARCH_MOVED | (success? MARCH_NEEDED: 0);
+            }
+            if (March_Retried(idx >> 8, idx & 0xff, direction)) {
+                luts[i][idx] |= MARCH_RETRIED;
+            }
+        }
+    }
+    return luts;
+}
+
+/**
+ * @brief Map_MarchValidateTravel using a compiled march decision table
+ *
+ * @param objid The object ID for which to perform direction logic
+ * @param data The Map_Object_Data array holding the object's facing
+ * @param pool The Random_Pool of the frame the decision is made on
+ * @param lut The compiled move
+ *
+ * @return bool indicating whether or not the specified objid chose
+ *         the DIRECTION_NEEDED direction.
+ */
+static inline bool Map_MarchLookupTravel(uint8_t objid, uint8_t *data, const uint8_t *pool, const march_lut_t lut)
+{
+    uint8_t d = lut[data[objid] << 8 | POOL_RANDOMN(pool, objid)];
+
+    if ((d & MARCH_MOVED) && g_verbose) {
+        printf("        %s: chose %s\n", Object_Name(objid), DIRSTRS[d & 3]);
+    }
+    if (d & MARCH_NEEDED) {
+        data[objid] = d & 3;
+    }
+    return d & MARCH_NEEDED;
+}
+
+/**
+ * Funnel counters
+ *
+ * Built with -DSMB3RNG_FUNNEL, every march decision counts the frames that
+ * reached it, the ones that passed it and the ones whose object had to
+ * choose again after a DIRECTION_INVALID direction, so a path without
+ * windows shows where its frames die. Each thread counts into a block of
+ * its own, and the blocks are summed and printed to stderr at exit. Without
+ * it the counting compiles to nothing.
+ */
+#ifdef SMB3RNG_FUNNEL
+struct funnel_count {
+    uint64_t reached;
+    uint64_t passed;
+    uint64_t retried;
+};
+
+struct funnel_block {
+    struct funnel_count *moves;     // per move in the Paths table, reference checks
+    struct funnel_count *nodes;     // per trie node, bit-sliced checks
+    struct funnel_block *next;
+};
+
+static __thread struct funnel_block *Funnel_Mine;
+static struct funnel_block *Funnel_New(void);
+
+static inline struct funnel_block *Funnel_Local(void)
+{
+    if (!Funnel_Mine) {
+        Funnel_Mine = Funnel_New();
+    }
+    return Funnel_Mine;
+}
+
+static inline void Funnel_Move(int m, uint8_t d)
+{
+    struct funnel_count *c = &Funnel_Local()->moves[m];
+
+    c->reached++;
+    c->passed += !!(d & MARCH_NEEDED);
+    c->retried += !!(d & MARCH_RETRIED);
+}
+
+#define FUNNEL_MOVE(m, d)   Funnel_Move(m, d)
+#else
+#define FUNNEL_MOVE(m, d)   do { } while (0)
+#endif
+
+static void usage(char *prog)
+{
+    fprintf(stderr, "Usage: ./%s [-i index [-b stride] [-q rng_bytes]] [-j threads] [-k top_windows] [-L level=lo:hi ...] [-O] [-R routes] [-s spec] [-P] [-S socket] [-C checkpoint] [-e end_iteration] [-B bitsets | -A bitsets] [-I seeds] [-o text|csv|jsonl|binary] [-m min_window] [-t 1|2] [-M movie.fm2] [start_iteration] [v|verbose]\n", prog);
     return;
 }
 
-static void print_randoms(uint8_t *p, size_t len)
+/**
+ * Scans stop at END_ITERATION unless -e says otherwise. Iterations stay far
+ * enough below INT64_MAX that end of level frames can't overflow.
+ */
+#define END_ITERATION   42767
+#define MAX_ITERATION   (INT64_MAX / 2)
+
+/**
+ * @brief Parse a whole decimal argument
+ *
+ * @param arg The argument
+ * @param lo The smallest value allowed
+ * @param hi The largest value allowed
+ * @param out Set to the value
+ * @return true if arg is a number from lo to hi
+ */
+static bool Parse_Number(const char *arg, int64_t lo, int64_t hi, int64_t *out)
+{
+    char *end;
+    long long v;
+
+    errno = 0;
+    v = strtoll(arg, &end, 10);
+    if (errno || end == arg || *end || v < lo || v > hi) {
+        return false;
+    }
+    *out = v;
+    return true;
+}
+
+/**
+ * @brief Write bytes in hex
+ *
+ * @param out Where to write them, 2 characters per byte and the separators
+ * @param p The bytes
+ * @param len The number of bytes
+ * @param sep The character between bytes, or '\0' for none
+ * @return The end of what was written
+ */
+static char *Hex_Bytes(char *out, const uint8_t *p, size_t len, char sep)
 {
-    printf("[");
-    for (size_t i = 0; i < len-1; i++) {
-        printf("%02x ", p[i]);
+    static const char digits[] = "0123456789abcdef";
+
+    for (size_t i = 0; i < len; i++) {
+        if (i && sep) {
+            *out++ = sep;
+        }
+        *out++ = digits[p[i] >> 4];
+        *out++ = digits[p[i] & 0xf];
     }
-    printf("%02x]\n", p[len-1]);
-    fflush(NULL);
+    return out;
+}
+
+static void print_randoms(const uint8_t *p, size_t len)
+{
+    char buf[3 * len + 2];
+
+    buf[0] = '[';
+    Hex_Bytes(buf + 1, p, len, ' ');
+    buf[3 * len] = ']';
+    buf[3 * len + 1] = '\n';
+    fwrite(buf, 1, sizeof(buf), stdout);
+}
+
+/**
+ * @brief The end of level lag frame of a good iteration of a path
+ *
+ * @param p The path
+ * @param iteration The iteration of the RNG that was checked
+ * @return The end of level lag frame
+ */
+static inline int64_t Path_EOLFrame(int p, int64_t iteration)
+{
+    int lvl = Paths.level[p];
+    /**
+     * The end of level lag frame occurs on the current tested iteration
+     * minus the number of frames between it and the initialization frame,
+     * minus the number of lag frames, minus the NUM_POWERUP_CLOUDS, and
+     * plus the number of lag frames that have occurred so far.
+     */
+    return iteration + Paths.lag_frames[lvl] - NUM_POWERUP_CLOUDS - Paths.eol_to_init_frames[lvl];
 }
 
 /**
  * @brief Checks to see if the current frame was a good one for
  * the Hammer Bros to choose their movement direction given the
- * constraints in the movement structure `m`.
+ * constraints of path `p`.
  *
+ * This only reads the pools in the ring, so it can be called for any
+ * number of paths and from any number of threads.
+ *
+ * @param r A ring holding the pools of iteration up to Check_Ticks later
  * @param iteration The iteration of the RNG we're checking
- * @param m A movement structure representing all the information required
+ * @param p The path in the Paths table, holding all the information required
  *        to make a determination whether it was a good frame or not
  *
  * @return 0 to indicate it was a bad frame to get the desired movement
@@ -434,61 +1224,48 @@ static void print_randoms(uint8_t *p, size_t len)
  *         The returned value indicates on which frame the end-level lag
  *         frame occurs.
  */
-static int CheckGoodMovement(int iteration, struct movement *m)
+static int64_t CheckGoodMovement(const struct rng_ring *r, int64_t iteration, int p)
 {
-    int i;
-    /**
-     * The end of level lag frame occurs on the current tested iteration
-     * minus the number of frames between it and the initialization frame,
-     * minus the number of lag frames, minus the NUM_POWERUP_CLOUDS, and
-     * plus the number of lag frames that have occurred so far.
-     */
-    int eolframe = iteration + m->lag_frames - NUM_POWERUP_CLOUDS - m->eol_to_init_frames;
+    uint8_t data[ARRAY_SIZE(Map_Object_Data)];
+    const uint8_t *pool = RNG_Ring_Pool(r, iteration);
+    int first = Paths.obj_first[p];
+    int last = first + Paths.obj_count[p];
 
     // Face the bros on the current frame
-    Initialize_Map_Object_Data(MUSIC_BOX);
-    Initialize_Map_Object_Data(HAMMER);
-    Randomize_N(m->face_to_move_frames);
-
-    for (i = 0; i < max(m->mb_moves, m->h_moves); i++) {
-        if ((i + 1) <= m->mb_moves) {
-            // Check music box
-            if (!Map_MarchValidateTravel(MUSIC_BOX, m->mb_move_array[i])) {
-                return 0;
-            }
-        }
-        if ((i + 1) <= m->h_moves) {
-            // Check hammer
-            if (!Map_MarchValidateTravel(HAMMER, m->h_move_array[i])) {
-                return 0;
-            }
+    for (int o = first; o < last; o++) {
+        Initialize_Map_Object_Data(data, pool, Paths.objid[o]);
+    }
+
+    // Each step, the objects make their moves in the order the path lists them
+    for (int k = Paths.plan_first[p]; k < Paths.plan_first[p + 1]; k++) {
+        int objid = Paths.plan_objid[k];
+        const march_lut_t *lut = &Paths.lut[Paths.plan_move[k]];
+
+        pool = RNG_Ring_Pool(r, iteration + Paths.plan_tick[k]);
+        FUNNEL_MOVE(Paths.plan_move[k], (*lut)[data[objid] << 8 | POOL_RANDOMN(pool, objid)]);
+        if (!Map_MarchLookupTravel(objid, data, pool, *lut)) {
+            return 0;
         }
-        // Frames during their movement
-        Randomize_N(NUM_FRAMES_FOR_ONE_MOVE);
     }
     // if we got here, success!
-    return eolframe;
+    return Path_EOLFrame(p, iteration);
 }
 
 #define _array(...)       { __VA_ARGS__ }
 #define _move_info(...)   { __VA_ARGS__ }
 
 #define CHECK_DEFINE(lvl, lag, eol2init, face2move, mb, h) \
-    static int Check_##lvl(int iteration)                   \
-    {                                                       \
-        struct move_info musicbox[] = mb;                   \
-        struct move_info hammer[]   = h;                    \
-        struct movement m = {                               \
-            .lag_frames             = lag,                  \
-            .eol_to_init_frames     = eol2init,             \
-            .face_to_move_frames    = face2move,            \
-            .mb_moves               = ARRAY_SIZE(musicbox), \
-            .mb_move_array          = musicbox,             \
-            .h_moves                = ARRAY_SIZE(hammer),   \
-            .h_move_array           = hammer,               \
-        };                                                  \
-        return CheckGoodMovement(iteration, &m);            \
-    }
+    static struct move_info lvl##_musicbox[] = mb;          \
+    static struct move_info lvl##_hammer[]   = h;           \
+    static const struct movement Movement_##lvl = {         \
+        .lag_frames             = lag,                      \
+        .eol_to_init_frames     = eol2init,                 \
+        .face_to_move_frames    = face2move,                \
+        .mb_moves               = ARRAY_SIZE(lvl##_musicbox), \
+        .mb_move_array          = lvl##_musicbox,           \
+        .h_moves                = ARRAY_SIZE(lvl##_hammer), \
+        .h_move_array           = lvl##_hammer,             \
+    };
 
 // 2-1 lag frames, frames between end of level and facing direction init
 #define W2L1_LAG_FRAMES         684
@@ -499,6 +1276,13 @@ static int CheckGoodMovement(int iteration, struct movement *m)
 // 2-f lag frames, frames between end of level and facing direction init
 #define W2Lf_LAG_FRAMES         869
 #define W2Lf_EOL2INIT_FRAMES    28
+/**
+ * Frames between the end of level lag frames of consecutive levels on the
+ * current route (18212, 20207 and 23079 in helper.lua), taken as the
+ * minimum the levels in between can be played in.
+ */
+#define W2L1_TO_W2L2_FRAMES     1995
+#define W2L2_TO_W2Lf_FRAMES     2872
 
 /**
  * Path __1:
@@ -621,208 +1405,5117 @@ CHECK_DEFINE(W2Lf__6, W2Lf_LAG_FRAMES, W2Lf_EOL2INIT_FRAMES, FORT_FACE_TO_MOVE_F
         _array(DIRECTION_INVALID, DIRECTION_NEEDED,   DIRECTION_FAIL,     DIRECTION_FAIL))
 )
 
-static int do_early_hammer(int start_frame)
+/**
+ * The builtin paths, in the order they are checked for every frame. Each
+ * path is made of its level's music box moves and then its hammer moves.
+ */
+static const struct builtin_path {
+    const char *level;
+    const char *name;
+    bool fort;
+    const struct movement *m;
+} BUILTIN_PATHS[] = {
+    { "2-1", "2-1__1", false, &Movement_W2L1__1 },
+    { "2-1", "2-1__2", false, &Movement_W2L1__2 },
+    { "2-2", "2-2__1", false, &Movement_W2L2__1 },
+    { "2-2", "2-2__2", false, &Movement_W2L2__2 },
+    { "2-f", "2-f__1", true,  &Movement_W2Lf__1 },
+    { "2-f", "2-f__3", true,  &Movement_W2Lf__3 },
+    { "2-f", "2-f__6", true,  &Movement_W2Lf__6 },
+};
+
+/**
+ * The builtin routes. Paths __1 and __2 share the 2-f movement of __1, and
+ * paths __3 and __6 only have their 2-f movement defined.
+ */
+static const struct builtin_route {
+    const char *name;
+    const char *paths[3];
+} BUILTIN_ROUTES[] = {
+    { "__1", { "2-1__1", "2-2__1", "2-f__1" } },
+    { "__2", { "2-1__2", "2-2__2", "2-f__1" } },
+};
+static const int BUILTIN_ROUTE_GAPS[3] = { 0, W2L1_TO_W2L2_FRAMES, W2L2_TO_W2Lf_FRAMES };
+
+/**
+ * Grow an array of the path table by one entry
+ */
+#define grow_array(arr, n) \
+    do {                                                            \
+        (arr) = realloc((arr), ((n) + 1) * sizeof(*(arr)));         \
+        if (!(arr)) {                                               \
+            fprintf(stderr, "Out of memory\n");                     \
+            exit(1);                                                \
+        }                                                           \
+    } while (0)
+
+static int Paths_FindLevel(const char *name)
 {
-    print_randoms(Random_Pool, sizeof(Random_Pool));
-    /**
-     * The loop here starts at 13 because the RNG array is initialized at frame 13
-     */
-    for (int i = 13; i < 42767; i++) {
-        /**
-         * The assumption is made that we won't check frame numbers that are less
-         * than the number of lag frames at 2f, minus the NUM_POWERUP_CLOUDS, minus
-         * the number of frames between when bro facing intitialization occurs and
-         * end of level. So start_frame should be at minimum this value. Realistically,
-         * start_frame is going to be in the 16000+ range for world 2.
-         */
-        Randomize();
-        if (i < start_frame) {
-            continue;
+    for (int l = 0; l < Paths.nlevels; l++) {
+        if (!strcmp(Paths.level_name[l], name)) {
+            return l;
         }
+    }
+    return -1;
+}
 
-        if (g_verbose) {
-            printf("\n(Iteration %d):\n", i);
-            print_randoms(Random_Pool, sizeof(Random_Pool));
-        }
+static int Paths_AddLevel(const char *name, int lag, int eol2init, int face2move, bool fort)
+{
+    int l = Paths.nlevels;
 
-        /**
-         * Checking 2-1
-         */
-        if (g_verbose) {
-            printf("    Checking 2-1\n");
-        }
-        {
-            int eol21;
-            {
-                SnapshotRNG();
-                eol21 = Check_W2L1__1(i);
-                RestoreRNG();
+    grow_array(Paths.level_name, l);
+    grow_array(Paths.lag_frames, l);
+    grow_array(Paths.eol_to_init_frames, l);
+    grow_array(Paths.face_to_move_frames, l);
+    grow_array(Paths.fort, l);
+    Paths.level_name[l] = strdup(name);
+    Paths.lag_frames[l] = lag;
+    Paths.eol_to_init_frames[l] = eol2init;
+    Paths.face_to_move_frames[l] = face2move;
+    Paths.fort[l] = fort;
+    return Paths.nlevels++;
+}
 
-                if (eol21) {
-                    update_windows(LEVEL_2_1__1, eol21);
-                }
-            }
-            {
-                SnapshotRNG();
-                eol21 = Check_W2L1__2(i);
-                RestoreRNG();
+static int Paths_AddPath(int level, const char *name)
+{
+    int p = Paths.npaths;
 
-                if (eol21) {
-                    update_windows(LEVEL_2_1__2, eol21);
-                }
-            }
-        }
+    grow_array(Paths.name, p);
+    grow_array(Paths.level, p);
+    grow_array(Paths.obj_first, p);
+    grow_array(Paths.obj_count, p);
+    Paths.name[p] = strdup(name);
+    Paths.level[p] = level;
+    Paths.obj_first[p] = Paths.nobjs;
+    Paths.obj_count[p] = 0;
+    return Paths.npaths++;
+}
 
-        /**
-         * Checking 2-2
-         */
-        if (g_verbose) {
-            printf("    Checking 2-2\n");
-        }
-        {
-            int eol22;
-            {
-                SnapshotRNG();
-                eol22 = Check_W2L2__1(i);
-                RestoreRNG();
+/**
+ * @brief Add an object to the last path added
+ *
+ * @param objid The object ID
+ * @return void
+ */
+static void Paths_AddObject(int objid)
+{
+    int o = Paths.nobjs;
 
-                if (eol22) {
-                    update_windows(LEVEL_2_2__1, eol22);
-                }
-            }
-            {
-                SnapshotRNG();
-                eol22 = Check_W2L2__2(i);
-                RestoreRNG();
+    grow_array(Paths.objid, o);
+    grow_array(Paths.move_first, o);
+    grow_array(Paths.move_count, o);
+    Paths.objid[o] = objid;
+    Paths.move_first[o] = Paths.nmoves;
+    Paths.move_count[o] = 0;
+    Paths.obj_count[Paths.npaths - 1]++;
+    Paths.nobjs++;
+}
 
-                if (eol22) {
-                    update_windows(LEVEL_2_2__2, eol22);
-                }
-            }
-        }
+/**
+ * @brief Add a move to the last object added
+ *
+ * @param mi The move
+ * @return void
+ */
+static void Paths_AddMove(const struct move_info *mi)
+{
+    grow_array(Paths.move, Paths.nmoves);
+    Paths.move[Paths.nmoves++] = *mi;
+    Paths.move_count[Paths.nobjs - 1]++;
+}
 
-        /**
-         * Checking 2-f
-         */
-        if (g_verbose) {
-            printf("    Checking 2-f\n");
+static int Paths_FindPath(const char *name)
+{
+    for (int p = 0; p < Paths.npaths; p++) {
+        if (!strcmp(Paths.name[p], name)) {
+            return p;
         }
-        {
-            int eol2f;
-            {
-                SnapshotRNG();
-                eol2f = Check_W2Lf__1(i);
-                RestoreRNG();
+    }
+    return -1;
+}
 
-                if (eol2f) {
-                    update_windows(LEVEL_2_F__1, eol2f);
-                }
-            }
-            {
-                SnapshotRNG();
-                eol2f = Check_W2Lf__3(i);
-                RestoreRNG();
+static void Paths_AddRoute(const char *name)
+{
+    int r = Paths.nroutes;
 
-                if (eol2f) {
-                    update_windows(LEVEL_2_F__3, eol2f);
-                }
-            }
-            {
-                SnapshotRNG();
-                eol2f = Check_W2Lf__6(i);
-                RestoreRNG();
+    grow_array(Paths.route_name, r);
+    grow_array(Paths.route_first, r);
+    grow_array(Paths.route_count, r);
+    Paths.route_name[r] = strdup(name);
+    Paths.route_first[r] = Paths.nsteps;
+    Paths.route_count[r] = 0;
+    Paths.nroutes++;
+}
 
-                if (eol2f) {
-                    update_windows(LEVEL_2_F__6, eol2f);
-                }
-            }
-        }
+/**
+ * @brief Add a path to the last route added
+ *
+ * @param p The path
+ * @param gap The minimum frames after the previous path's EOL frame
+ * @return void
+ */
+static void Paths_AddStep(int p, int gap)
+{
+    grow_array(Paths.step_path, Paths.nsteps);
+    grow_array(Paths.step_gap, Paths.nsteps);
+    Paths.step_path[Paths.nsteps] = p;
+    Paths.step_gap[Paths.nsteps] = gap;
+    Paths.nsteps++;
+    Paths.route_count[Paths.nroutes - 1]++;
+}
 
-#if 0
-        bool success;
-        /**
-         * Checking HAMMER fight
-         */
-        printf("\tChecking MusicBox post-hammer\n");
-        SnapshotRNG();
-        Initialize_Map_Object_Data(MUSIC_BOX);
-        Initialize_Map_Object_Data(HAMMER);
-
-        const int lagph = 881;
-        const int end_of_ph_to_init_frames = 28;
-        //                           RIGHT              LEFT              DOWN                     UP
-        int musicbox_ph_1[] =   {DIRECTION_FAIL,    DIRECTION_FAIL,     DIRECTION_FAIL,     DIRECTION_NEEDED};
-        int musicbox_ph_2[] =   {DIRECTION_NEEDED,  DIRECTION_INVALID,  DIRECTION_FAIL,     DIRECTION_FAIL};
-        success = false;
-        eolframe = i+lagph-61-end_of_ph_to_init_frames;
-
-        Randomize_N(55);
-        printf("\t55 iterations later:\n\t");
-        print_randoms(Random_Pool, sizeof(Random_Pool));
-        if (Map_MarchValidateTravel_generic(MUSIC_BOX, musicbox_ph_1)) {
-            Randomize_N(32);
-            if (Map_MarchValidateTravel_generic(MUSIC_BOX, musicbox_ph_2)) {
-                success = true;
-
-                printf("\t\t2-f SUCCESS ON end of level FRAME %" PRId64 "\n\t\t", eolframe);
-                print_randoms(Random_Pool_backup, sizeof(Random_Pool_backup));
-                printf("\n\n");
-
-                if (last2f == (i-1)) {
-                    run2f += 1;
-                } else {
-                    run2f = 1;
-                }
-                if (run2f > maxrun2f) {
-                    maxrun2f = run2f;
-                    maxrun2fframe = eolframe;
-                }
-                last2f = i;
-            }
+static void Paths_AddBuiltins(void)
+{
+    for (int b = 0; b < ARRAY_SIZE(BUILTIN_PATHS); b++) {
+        const struct builtin_path *bp = &BUILTIN_PATHS[b];
+        const struct movement *m = bp->m;
+        int l = Paths_FindLevel(bp->level);
+
+        if (l < 0) {
+            l = Paths_AddLevel(bp->level, m->lag_frames, m->eol_to_init_frames,
+                               m->face_to_move_frames, bp->fort);
+        }
+        Paths_AddPath(l, bp->name);
+        Paths_AddObject(MUSIC_BOX);
+        for (int i = 0; i < m->mb_moves; i++) {
+            Paths_AddMove(&m->mb_move_array[i]);
+        }
+        Paths_AddObject(HAMMER);
+        for (int i = 0; i < m->h_moves; i++) {
+            Paths_AddMove(&m->h_move_array[i]);
         }
-#endif /* 0 */
     }
-
-    printf("Max window for 2-1__1: %d\n", windowmax[LEVEL_2_1__1]);
-    printf("Max window for 2-1__2: %d\n", windowmax[LEVEL_2_1__2]);
-    printf("Max window for 2-2__1: %d\n", windowmax[LEVEL_2_2__1]);
-    printf("Max window for 2-2__2: %d\n", windowmax[LEVEL_2_2__2]);
-    printf("Max window for 2-f__1: %d\n", windowmax[LEVEL_2_F__1]);
-    printf("Max window for 2-f__3: %d\n", windowmax[LEVEL_2_F__3]);
-    printf("Max window for 2-f__6: %d\n", windowmax[LEVEL_2_F__6]);
-    for (int i = 0; i < ARRAY_SIZE(max_windows); i++) {
-        printf("%s:\n", LVLSTRS[i]);
-        for (int len = 2; len <= windowmax[i]; len++) {
-            struct window_node *w = max_windows[i];
-            printf("  %d-frame windows:\n", len);
-            while (w) {
-                if (w->window_length == len) {
-                    printf("    EOL: %d\n        init rng ", w->eol_frame);
-                    print_randoms(w->rng, sizeof(w->rng));
-                }
-                w = w->next;
-            }
+    for (int r = 0; r < ARRAY_SIZE(BUILTIN_ROUTES); r++) {
+        Paths_AddRoute(BUILTIN_ROUTES[r].name);
+        for (int k = 0; k < ARRAY_SIZE(BUILTIN_ROUTES[r].paths); k++) {
+            Paths_AddStep(Paths_FindPath(BUILTIN_ROUTES[r].paths[k]), BUILTIN_ROUTE_GAPS[k]);
         }
     }
+}
+
+// The letters of a move in a spec, indexed by DIRECTION_* enum
+static const char MOVE_CHARS[] = "FIN";
+
+// Set while the library loads paths, see smb3rng_init()
+static jmp_buf *Paths_Jmp;
+static char Paths_ErrorMsg[256];
+
+/**
+ * @brief Give up on loading the paths
+ *
+ * The scanner exits, but the library returns to smb3rng_init() with the
+ * message instead of taking the emulator down with it.
+ *
+ * @param fmt printf format of the message, without a newline
+ * @return Does not return
+ */
+static void __attribute__((noreturn)) Paths_Fail(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    if (Paths_Jmp) {
+        vsnprintf(Paths_ErrorMsg, sizeof(Paths_ErrorMsg), fmt, ap);
+        va_end(ap);
+        longjmp(*Paths_Jmp, 1);
+    }
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    exit(1);
+}
 
-    return 0;
+static void __attribute__((noreturn)) Paths_Error(const char *file, int line, const char *msg)
+{
+    Paths_Fail("%s:%d: %s", file, line, msg);
 }
 
-int main(int argc, char **argv)
+/**
+ * @brief Parse a <name>=<frames> parameter of a level
+ *
+ * @return true if tok is the parameter, a bad number is an error
+ */
+static bool Paths_Param(const char *file, int line, const char *tok, const char *name, int *out)
 {
-    if (argc > 3) {
-        usage(argv[0]);
-        exit(1);
+    size_t len = strlen(name);
+    int64_t v;
+
+    if (strncmp(tok, name, len) || tok[len] != '=') {
+        return false;
     }
+    if (!Parse_Number(tok + len + 1, 0, INT_MAX, &v)) {
+        Paths_Fail("%s:%d: %s needs a number of frames", file, line, name);
+    }
+    *out = v;
+    return true;
+}
+
+/**
+ * @brief Load the paths to check from a spec file
+ *
+ * The spec is line based, and '#' starts a comment:
+ *
+ *   level <name> lag=<frames> eol2init=<frames> face2move=<frames> [fort]
+ *   path <name>
+ *   object <objid> <move> [<move> ...]
+ *   route <name> <path> [<frames> <path> ...]
+ *
+ * A path belongs to the level above it, and an object to the path above it.
+ * An object is the index of its RandomN byte, 2 for the music box and 3 for
+ * the hammer. Each move is four letters giving the result of moving RIGHT,
+ * LEFT, DOWN and UP: N for DIRECTION_NEEDED, F for DIRECTION_FAIL and I for
+ * DIRECTION_INVALID. Paths are checked in the order they are listed, and
+ * their names are what the report, routes and queries know them by, so
+ * each is used once. A route lists paths defined above it, in the order
+ * they are played, with the minimum frames between their end of level lag
+ * frames in between.
+ * `-P` prints the builtin paths in this format.
+ *
+ * @param file The spec file
+ * @return void
+ */
+static void Paths_Load(const char *file)
+{
+    FILE *f = fopen(file, "r");
+    char buf[1024];
+    int line = 0;
+    int level = -1;
 
-    int start = 2000;
-    if (argc == 2) {
-        start = atoi(argv[2]);
+    if (!f) {
+        Paths_Fail("Could not open %s: %s", file, strerror(errno));
     }
+    while (fgets(buf, sizeof(buf), f)) {
+        char *save, *tok, *c;
 
-    if (argc == 3) {
-        g_verbose = true;
+        line++;
+        if ((c = strchr(buf, '#'))) {
+            *c = '\0';
+        }
+        if (!(tok = strtok_r(buf, " \t\r\n", &save))) {
+            continue;
+        }
+
+        if (!strcmp(tok, "level")) {
+            int lag = -1, eol2init = -1, face2move = -1;
+            bool fort = false;
+            char *name = strtok_r(NULL, " \t\r\n", &save);
+
+            if (!name) {
+                Paths_Error(file, line, "level needs a name");
+            }
+            while ((tok = strtok_r(NULL, " \t\r\n", &save))) {
+                if (!strcmp(tok, "fort")) {
+                    fort = true;
+                } else if (!Paths_Param(file, line, tok, "lag", &lag) &&
+                           !Paths_Param(file, line, tok, "eol2init", &eol2init) &&
+                           !Paths_Param(file, line, tok, "face2move", &face2move)) {
+                    Paths_Error(file, line, "unknown level parameter");
+                }
+            }
+            if (lag < 0 || eol2init < 0 || face2move < 0) {
+                Paths_Error(file, line, "level needs lag, eol2init and face2move");
+            }
+            // Paths of a level can be listed again under the same level line
+            if ((level = Paths_FindLevel(name)) < 0) {
+                level = Paths_AddLevel(name, lag, eol2init, face2move, fort);
+            } else if (Paths.lag_frames[level] != lag || Paths.eol_to_init_frames[level] != eol2init ||
+                       Paths.face_to_move_frames[level] != face2move || Paths.fort[level] != fort) {
+                Paths_Error(file, line, "level redefined with different parameters");
+            }
+        } else if (!strcmp(tok, "path")) {
+            char *name = strtok_r(NULL, " \t\r\n", &save);
+
+            if (level < 0) {
+                Paths_Error(file, line, "path before any level");
+            }
+            if (!name) {
+                Paths_Error(file, line, "path needs a name");
+            }
+            if (Paths.npaths && !Paths.obj_count[Paths.npaths - 1]) {
+                Paths_Error(file, line, "previous path has no objects");
+            }
+            if (Paths_FindPath(name) >= 0) {
+                Paths_Error(file, line, "path redefined");
+            }
+            Paths_AddPath(level, name);
+        } else if (!strcmp(tok, "object")) {
+            char *objstr = strtok_r(NULL, " \t\r\n", &save);
+            int64_t objid;
+
+            if (!Paths.npaths) {
+                Paths_Error(file, line, "object before any path");
+            }
+            if (!objstr || !Parse_Number(objstr, 0, NUM_OBJECTS - 1, &objid)) {
+                Paths_Error(file, line, "object needs an objid from 0 to 7");
+            }
+            for (int o = Paths.obj_first[Paths.npaths - 1]; o < Paths.nobjs; o++) {
+                if (Paths.objid[o] == objid) {
+                    Paths_Error(file, line, "duplicate object in path");
+                }
+            }
+            Paths_AddObject(objid);
+            while ((tok = strtok_r(NULL, " \t\r\n", &save))) {
+                struct move_info mi;
+
+                if (strlen(tok) != 4) {
+                    Paths_Error(file, line, "a move is 4 letters of N, F or I");
+                }
+                for (int d = 0; d < 4; d++) {
+                    const char *m = strchr(MOVE_CHARS, tok[d]);
+                    if (!m || !*m) {
+                        Paths_Error(file, line, "a move is 4 letters of N, F or I");
+                    }
+                    mi.dir[d] = m - MOVE_CHARS;
+                }
+                Paths_AddMove(&mi);
+            }
+            if (!Paths.move_count[Paths.nobjs - 1]) {
+                Paths_Error(file, line, "object has no moves");
+            }
+        } else if (!strcmp(tok, "route")) {
+            char *name = strtok_r(NULL, " \t\r\n", &save);
+            bool want_path = true;
+            int64_t gap = 0;
+
+            if (!name) {
+                Paths_Error(file, line, "route needs a name");
+            }
+            Paths_AddRoute(name);
+            while ((tok = strtok_r(NULL, " \t\r\n", &save))) {
+                if (want_path) {
+                    int p = Paths_FindPath(tok);
+                    if (p < 0) {
+                        Paths_Error(file, line, "unknown path in route");
+                    }
+                    Paths_AddStep(p, gap);
+                } else if (!Parse_Number(tok, 0, INT_MAX, &gap)) {
+                    Paths_Error(file, line, "expected the frames to the next path");
+                }
+                want_path = !want_path;
+            }
+            if (want_path) {
+                Paths_Error(file, line, "route needs paths separated by frames");
+            }
+        } else {
+            Paths_Error(file, line, "expected level, path, object or route");
+        }
+    }
+    fclose(f);
+    if (!Paths.npaths || !Paths.obj_count[Paths.npaths - 1]) {
+        Paths_Error(file, line, "spec needs at least one path with objects");
+    }
+}
+
+/**
+ * @brief Print the path table as a spec, see Paths_Load()
+ *
+ * @param f The stream to print to
+ * @return void
+ */
+static void Paths_Print(FILE *f)
+{
+    int level = -1;
+
+    for (int p = 0; p < Paths.npaths; p++) {
+        int l = Paths.level[p];
+
+        if (l != level) {
+            fprintf(f, "%slevel %s lag=%d eol2init=%d face2move=%d%s\n", (level < 0)? "": "\n",
+                    Paths.level_name[l], Paths.lag_frames[l], Paths.eol_to_init_frames[l],
+                    Paths.face_to_move_frames[l], Paths.fort[l]? " fort": "");
+            level = l;
+        }
+        fprintf(f, "path %s\n", Paths.name[p]);
+        for (int o = Paths.obj_first[p]; o < Paths.obj_first[p] + Paths.obj_count[p]; o++) {
+            fprintf(f, "    object %d", Paths.objid[o]);
+            for (int i = Paths.move_first[o]; i < Paths.move_first[o] + Paths.move_count[o]; i++) {
+                fprintf(f, " %c%c%c%c", MOVE_CHARS[Paths.move[i].dir[RIGHT]], MOVE_CHARS[Paths.move[i].dir[LEFT]],
+                        MOVE_CHARS[Paths.move[i].dir[DOWN]], MOVE_CHARS[Paths.move[i].dir[UP]]);
+            }
+            fprintf(f, "\n");
+        }
+    }
+    if (Paths.nroutes) {
+        fprintf(f, "\n");
+    }
+    for (int r = 0; r < Paths.nroutes; r++) {
+        fprintf(f, "route %s", Paths.route_name[r]);
+        for (int k = Paths.route_first[r]; k < Paths.route_first[r] + Paths.route_count[r]; k++) {
+            if (k > Paths.route_first[r]) {
+                fprintf(f, " %d", Paths.step_gap[k]);
+            }
+            fprintf(f, " %s", Paths.name[Paths.step_path[k]]);
+        }
+        fprintf(f, "\n");
+    }
+}
+
+/**
+ * FM2 movies
+ *
+ * The lag of a level is only known from playing the movie back, so it is
+ * noted in the movie itself, as an FM2 subtitle on the level's end of
+ * level lag frame:
+ *
+ *   subtitle 18212 smb3rng 2-1 lag=688
+ *
+ * -M movie.fm2 sets the lag of every level marked like that, and scans the
+ * iterations around the marks unless the range is given. The movie is
+ * mapped and read in place, the input log is only counted.
+ */
+#define MOVIE_SCAN_MARGIN   4096    // iterations scanned on either side of the marks
+#define MOVIE_LINE_MAX      256
+
+/**
+ * @brief Parse a decimal number from the start of some text, like
+ * Parse_Number() does a whole argument
+ *
+ * @param p The text, moved past the number
+ * @param end The end of the text
+ * @param hi The largest number accepted
+ * @param out Set to the number
+ * @return true if there was a number no larger than hi, ending the text or
+ *         followed by a space
+ */
+static bool Movie_Number(const char **p, const char *end, int64_t hi, int64_t *out)
+{
+    const char *q = *p;
+    int64_t v = 0;
+
+    while (q < end && *q >= '0' && *q <= '9') {
+        if (v > (hi - (*q - '0')) / 10) {
+            return false;
+        }
+        v = v * 10 + (*q++ - '0');
+    }
+    if (q == *p || (q < end && *q != ' ' && *q != '\t' && *q != '\r')) {
+        return false;
+    }
+    *p = q;
+    *out = v;
+    return true;
+}
+
+/**
+ * @brief Whether a line of a movie is a lag mark, well formed or not
+ *
+ * @param q The line
+ * @param eol The end of the line
+ * @return The text after "subtitle <frame> smb3rng ", or NULL
+ */
+static const char *Movie_Mark(const char *q, const char *eol)
+{
+    if (eol - q < 9 || memcmp(q, "subtitle ", 9)) {
+        return NULL;
+    }
+    q += 9;
+    if (q == eol || *q < '0' || *q > '9') {
+        return NULL;
+    }
+    while (q < eol && *q >= '0' && *q <= '9') {
+        q++;
+    }
+    if (eol - q < 9 || memcmp(q, " smb3rng ", 9)) {
+        return NULL;
+    }
+    return q + 9;
+}
+
+/**
+ * @brief Apply the lag marks of an FM2 movie to the levels
+ *
+ * @param file The movie
+ * @param first Set to the iteration of the earliest mark
+ * @param last Set to the iteration of the latest mark
+ * @return The number of marks
+ */
+static int Movie_Load(const char *file, int64_t *first, int64_t *last)
+{
+    struct stat st;
+    const char *map, *p, *end;
+    int64_t frames = 0;
+    int marks = 0, line = 0;
+    int fd = open(file, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &st)) {
+        fprintf(stderr, "Could not open %s: %s\n", file, strerror(errno));
+        exit(1);
+    }
+    map = st.st_size? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0): "";
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Could not map %s: %s\n", file, strerror(errno));
+        exit(1);
+    }
+    close(fd);
+    end = map + st.st_size;
+    madvise((void *)map, st.st_size, MADV_SEQUENTIAL);
+
+    for (p = map; p < end; ) {
+        const char *nl = memchr(p, '\n', end - p);
+        const char *eol = nl? nl: end;
+        const char *q = p, *mark;
+        char name[MOVIE_LINE_MAX];
+        int64_t frame, lag;
+        int n, l;
+
+        line++;
+        if (*p == '|') {
+            // The input log, one frame a line, is all that is left
+            for (frames = 1; nl && nl + 1 < end; frames++) {
+                nl = memchr(nl + 1, '\n', end - nl - 1);
+            }
+            break;
+        }
+        p = nl? nl + 1: end;
+        if (!(mark = Movie_Mark(q, eol))) {
+            continue;
+        }
+        q += 9;
+        if (!Movie_Number(&q, eol, MAX_ITERATION, &frame)) {
+            fprintf(stderr, "%s:%d: expected subtitle <frame> smb3rng <level> lag=<frames>\n", file, line);
+            exit(1);
+        }
+        q = mark;
+        for (n = 0; q < eol && *q != ' ' && *q != '\r' && n < MOVIE_LINE_MAX - 1; ) {
+            name[n++] = *q++;
+        }
+        name[n] = '\0';
+        if (eol - q < 5 || memcmp(q, " lag=", 5) || (q += 5, !Movie_Number(&q, eol, INT_MAX, &lag))) {
+            fprintf(stderr, "%s:%d: expected subtitle <frame> smb3rng <level> lag=<frames>\n", file, line);
+            exit(1);
+        }
+        if ((l = Paths_FindLevel(name)) < 0) {
+            fprintf(stderr, "%s:%d: no level %s\n", file, line, name);
+            exit(1);
+        }
+
+        Paths.lag_frames[l] = lag;
+        // Path_EOLFrame() the other way around
+        frame += NUM_POWERUP_CLOUDS + Paths.eol_to_init_frames[l] - lag;
+        if (!marks++ || frame < *first) {
+            *first = frame;
+        }
+        if (marks == 1 || frame > *last) {
+            *last = frame;
+        }
+        fprintf(stderr, "Movie %s: level %s, %" PRId64 " lag frames, iteration %" PRId64 "\n",
+                file, name, lag, frame);
+    }
+    fprintf(stderr, "Movie %s: %" PRId64 " frames, %d marks\n", file, frames, marks);
+    if (st.st_size) {
+        munmap((void *)map, st.st_size);
+    }
+    return marks;
+}
+
+/**
+ * The furthest any path looks ahead of the frame it is checking
+ */
+static int Check_Ticks;
+
+/**
+ * @brief The path compilation stage, run once at startup
+ *
+ * @return void
+ */
+static void Compile_Paths(void)
+{
+    int k = 0;
+
+    Paths.lut = Compile_Moves(Paths.nmoves, Paths.move);
+    Paths.plan_first = calloc(Paths.npaths + 1, sizeof(*Paths.plan_first));
+    Paths.plan_objid = calloc(max(Paths.nmoves, 1), sizeof(*Paths.plan_objid));
+    Paths.plan_move = calloc(max(Paths.nmoves, 1), sizeof(*Paths.plan_move));
+    Paths.plan_tick = calloc(max(Paths.nmoves, 1), sizeof(*Paths.plan_tick));
+    for (int p = 0; p < Paths.npaths; p++) {
+        int first = Paths.obj_first[p], last = first + Paths.obj_count[p];
+        int moves = 0;
+
+        for (int o = first; o < last; o++) {
+            moves = max(moves, Paths.move_count[o]);
+        }
+        Paths.plan_first[p] = k;
+        // Lay the decisions out step-major, so the check walks one array
+        // however many objects the path moves
+        for (int i = 0; i < moves; i++) {
+            for (int o = first; o < last; o++) {
+                if (i < Paths.move_count[o]) {
+                    Paths.plan_objid[k] = Paths.objid[o];
+                    Paths.plan_move[k] = Paths.move_first[o] + i;
+                    Paths.plan_tick[k] = Paths.face_to_move_frames[Paths.level[p]] +
+                                         NUM_FRAMES_FOR_ONE_MOVE * i;
+                    Check_Ticks = max(Check_Ticks, Paths.plan_tick[k]);
+                    k++;
+                }
+            }
+        }
+    }
+    Paths.plan_first[Paths.npaths] = k;
+
+    if (Check_Ticks >= RNG_RING_SIZE) {
+        Paths_Fail("Paths look %d ticks ahead, RNG_RING_SIZE is only %d",
+                   Check_Ticks, RNG_RING_SIZE);
+    }
+}
+
+/**
+ * Bit-sliced checks
+ *
+ * Instead of checking one frame at a time, SLICE_LANES consecutive frames
+ * are checked at once. Bit p of the Random_Pool of every frame in the block
+ * is stored transposed in one slice_t word, where lane j is the frame
+ * start + j. Bit p counts from the least-significant bit of Random_Pool[8]
+ * up to the most-significant bit of Random_Pool[0], so a Randomize() tick
+ * moves every bit down one position and feeds bit 65 ^ bit 57 into bit 71.
+ *
+ * Rather than ticking the words in place, the block keeps the whole stream
+ * of bits the LFSR produces: W[k] = W[k - 7] ^ W[k - 15] for k >= 72. The
+ * pools of every lane t ticks later are then simply W[t] to W[t + 71], and
+ * the march decisions become boolean logic over those words.
+ */
+#ifdef __AVX2__
+typedef uint64_t slice_t __attribute__((vector_size(32)));
+#else
+typedef uint64_t slice_t;
+#endif
+#define SLICE_WORDS (sizeof(slice_t) / sizeof(uint64_t))
+#define SLICE_LANES ((int)SLICE_WORDS * 64)
+
+// Bit position of bit m of RandomN[objid]
+#define SLICE_RANDOMN_BIT(objid, m)   ((7 - (objid)) * 8 + (m))
+
+/**
+ * A move_info precompiled for every facing and every combination of the
+ * three RandomN bits the decision reads, x = bit 0 | bit 1 << 1 | bit 7 << 2.
+ */
+struct sliced_move {
+    uint8_t ok[4];          // per facing, the x that choose DIRECTION_NEEDED
+    uint8_t face[2][4];     // per facing, the x whose new facing has bit 0/1 set
+    uint8_t retry[4];       // per facing, the x that choose again, see MARCH_RETRIED
+};
+
+static int Sliced_Ticks;
+
+static inline bool Slice_Any(slice_t v)
+{
+    for (int w = 0; w < SLICE_WORDS; w++) {
+        if (((const uint64_t *)&v)[w]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline int Slice_Lane(slice_t v, int j)
+{
+    return (((const uint64_t *)&v)[j / 64] >> (j % 64)) & 1;
+}
+
+static inline void Slice_SetLane(slice_t *v, int j)
+{
+    ((uint64_t *)v)[j / 64] |= 1ULL << (j % 64);
+}
+
+/**
+ * @brief The first n lanes of a slice
+ */
+static inline slice_t Slice_FirstLanes(int n)
+{
+    slice_t v = { 0 };
+
+    for (int w = 0; w < SLICE_WORDS; w++, n -= 64) {
+        ((uint64_t *)&v)[w] = (n >= 64)? ~0ULL: (n > 0)? (1ULL << n) - 1: 0;
+    }
+    return v;
+}
+
+/**
+ * @brief The number of words in a bitset of frames, whole blocks of them
+ */
+static inline int Bitset_Words(int frames)
+{
+    return (frames + SLICE_LANES - 1) / SLICE_LANES * SLICE_WORDS;
+}
+
+/**
+ * @brief Reduce a compiled move to the three RandomN bits it depends on
+ *
+ * @param lut The compiled move
+ * @param sm Storage for the bit-sliced move
+ * @return void
+ */
+static void Sliced_CompileMove(const march_lut_t lut, struct sliced_move *sm)
+{
+    memset(sm, 0, sizeof(*sm));
+    for (int f = 0; f < 4; f++) {
+        for (int x = 0; x < 8; x++) {
+            uint8_t random = (x & 3) | ((x & 4)? 0x80: 0);
+            uint8_t d = lut[f << 8 | random];
+            if (d & MARCH_RETRIED) {
+                sm->retry[f] |= 1 << x;
+            }
+            if (d & MARCH_NEEDED) {
+                sm->ok[f] |= 1 << x;
+                if (d & 1) {
+                    sm->face[0][f] |= 1 << x;
+                }
+                if (d & 2) {
+                    sm->face[1][f] |= 1 << x;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Bit-sliced Map_MarchValidateTravel for every lane at once
+ *
+ * @param sm The compiled move
+ * @param w The stream positioned at bit 0 of the object's RandomN byte
+ * @param f0 Bit 0 of every lane's facing, updated to the new facing
+ * @param f1 Bit 1 of every lane's facing, updated to the new facing
+ * @return The lanes that chose the DIRECTION_NEEDED direction
+ */
+static inline slice_t Sliced_March(const struct sliced_move *sm, const slice_t *w, slice_t *f0, slice_t *f1)
+{
+    slice_t d0 = w[0], d1 = w[1], inc = w[7];
+    slice_t ok = { 0 }, n0 = { 0 }, n1 = { 0 };
+    slice_t dm[8];
+
+    for (int x = 0; x < 8; x++) {
+        dm[x] = ((x & 1)? d0: ~d0) & ((x & 2)? d1: ~d1) & ((x & 4)? inc: ~inc);
+    }
+    for (int f = 0; f < 4; f++) {
+        slice_t fm = ((f & 1)? *f0: ~*f0) & ((f & 2)? *f1: ~*f1);
+        slice_t o = { 0 }, a = { 0 }, b = { 0 };
+        for (int x = 0; x < 8; x++) {
+            if (sm->ok[f] & (1 << x)) {
+                o |= dm[x];
+            }
+            if (sm->face[0][f] & (1 << x)) {
+                a |= dm[x];
+            }
+            if (sm->face[1][f] & (1 << x)) {
+                b |= dm[x];
+            }
+        }
+        ok |= fm & o;
+        n0 |= fm & a;
+        n1 |= fm & b;
+    }
+    *f0 = n0;
+    *f1 = n1;
+    return ok;
+}
+
+#ifdef SMB3RNG_FUNNEL
+/**
+ * @brief The lanes whose object chose again after a DIRECTION_INVALID
+ *
+ * @param sm The compiled move
+ * @param w The stream positioned at bit 0 of the object's RandomN byte
+ * @param f0 Bit 0 of every lane's facing before the move
+ * @param f1 Bit 1 of every lane's facing before the move
+ * @return The lanes
+ */
+static inline slice_t Sliced_Retried(const struct sliced_move *sm, const slice_t *w, slice_t f0, slice_t f1)
+{
+    slice_t retried = { 0 };
+
+    for (int f = 0; f < 4; f++) {
+        slice_t fm = ((f & 1)? f0: ~f0) & ((f & 2)? f1: ~f1);
+        for (int x = 0; x < 8; x++) {
+            if (sm->retry[f] & (1 << x)) {
+                retried |= fm & ((x & 1)? w[0]: ~w[0]) & ((x & 2)? w[1]: ~w[1]) &
+                           ((x & 4)? w[7]: ~w[7]);
+            }
+        }
+    }
+    return retried;
+}
+
+static inline uint64_t Slice_Count(slice_t v)
+{
+    uint64_t n = 0;
+
+    for (int w = 0; w < SLICE_WORDS; w++) {
+        n += __builtin_popcountll(((const uint64_t *)&v)[w]);
+    }
+    return n;
+}
+
+static inline void Funnel_Node(int id, slice_t reached, slice_t passed, slice_t retried)
+{
+    struct funnel_count *c = &Funnel_Local()->nodes[id];
+
+    c->reached += Slice_Count(reached);
+    c->passed += Slice_Count(passed);
+    c->retried += Slice_Count(retried);
+}
+
+#define FUNNEL_NODE(id, reached, passed, retried)   Funnel_Node(id, reached, passed, retried)
+#else
+#define FUNNEL_NODE(id, reached, passed, retried)   do { } while (0)
+#endif
+
+/**
+ * Path trie
+ *
+ * A path's decisions only depend on how many ticks after the checked frame
+ * they are made, not on its lag or level, so the paths are grouped by their
+ * face-to-move frames and every group is compiled into a trie of (object,
+ * tick, move) decisions. Paths that have the same first decisions share
+ * them, so each block walks every group once, only branches where paths
+ * diverge, and drops a whole subtree as soon as no lane is left alive.
+ *
+ * The objects of a path are independent of each other, so a path is decided
+ * one object at a time rather than one move at a time. The object with the
+ * fewest distinct move sequences in the group goes first, which gives the
+ * paths the longest common prefixes.
+ */
+struct trie_node {
+    int id;
+    int slot;                       // index into the group's objids
+    int tick;                       // ticks after the checked frame
+    int reg;                        // the facing register the move reads, see Trie_Walk()
+    int facing;                     // the facing it is decided from instead, or -1
+    const struct move_info *move;
+    struct sliced_move sm;
+    int nchildren;
+    struct trie_node **children;
+    int npaths;
+    int *paths;                     // paths that pass once this node does
+};
+
+struct trie_group {
+    int face_to_move_frames;
+    int nobjs;
+    int objids[NUM_OBJECTS];
+    struct trie_node root;
+};
+
+static struct trie_group *Trie_Groups;
+static int Trie_NumGroups;
+static int Trie_NumNodes;
+// Facing registers per slot, one more than the most moves of any object
+static int Trie_Regs;
+
+/**
+ * A decision of a path in the order the trie makes them
+ */
+struct trie_decision {
+    int slot;
+    int move;           // the object's move index
+    int m;              // the move in the Paths table
+    int facing;         // see trie_node
+};
+
+/**
+ * @brief The moves a path has for one object
+ *
+ * @param p The path
+ * @param objid The object
+ * @param first Set to the index of the first move in the Paths table
+ * @return The number of moves, 0 if the path does not move the object
+ */
+static int Path_Moves(int p, int objid, int *first)
+{
+    for (int o = Paths.obj_first[p]; o < Paths.obj_first[p] + Paths.obj_count[p]; o++) {
+        if (Paths.objid[o] == objid) {
+            *first = Paths.move_first[o];
+            return Paths.move_count[o];
+        }
+    }
+    *first = 0;
+    return 0;
+}
+
+static bool Same_Moves(const struct move_info *a, int na, const struct move_info *b, int nb)
+{
+    return na == nb && !memcmp(a, b, na * sizeof(*a));
+}
+
+static inline int Path_FaceToMove(int p)
+{
+    return Paths.face_to_move_frames[Paths.level[p]];
+}
+
+/**
+ * @brief Find the child of a node deciding a move, adding it if needed
+ *
+ * @return The child node
+ */
+static struct trie_node *Trie_Child(struct trie_node *n, const struct trie_group *g,
+                                    const struct trie_decision *d)
+{
+    const struct move_info *move = &Paths.move[d->m];
+    int tick = g->face_to_move_frames + NUM_FRAMES_FOR_ONE_MOVE * d->move;
+    struct trie_node *ch;
+
+    for (int c = 0; c < n->nchildren; c++) {
+        ch = n->children[c];
+        if (ch->slot == d->slot && ch->tick == tick && ch->facing == d->facing &&
+            Same_Moves(ch->move, 1, move, 1)) {
+            return ch;
+        }
+    }
+    ch = calloc(1, sizeof(*ch));
+    ch->id = Trie_NumNodes++;
+    ch->slot = d->slot;
+    ch->tick = tick;
+    ch->reg = d->slot * Trie_Regs + d->move;
+    ch->facing = d->facing;
+    ch->move = move;
+    Sliced_CompileMove(Paths.lut[d->m], &ch->sm);
+    n->children = realloc(n->children, (n->nchildren + 1) * sizeof(*n->children));
+    n->children[n->nchildren++] = ch;
+    return ch;
+}
+
+/**
+ * @brief Pick the order the objects of a group are decided in
+ *
+ * @param g The group, with objids in the order they were seen
+ * @return void
+ */
+static void Trie_OrderObjects(struct trie_group *g)
+{
+    int distinct[NUM_OBJECTS] = { 0 };
+
+    for (int o = 0; o < g->nobjs; o++) {
+        // Count the paths whose sequence for this object no earlier path has
+        for (int p = 0; p < Paths.npaths; p++) {
+            int first, other, n, k;
+
+            if (Path_FaceToMove(p) != g->face_to_move_frames) {
+                continue;
+            }
+            n = Path_Moves(p, g->objids[o], &first);
+            for (k = 0; k < p; k++) {
+                if (Path_FaceToMove(k) == g->face_to_move_frames &&
+                    Same_Moves(&Paths.move[first], n, &Paths.move[other],
+                               Path_Moves(k, g->objids[o], &other))) {
+                    break;
+                }
+            }
+            distinct[o] += (k == p);
+        }
+    }
+
+    // Insertion sort, ties keep the order the objects were seen in
+    for (int o = 1; o < g->nobjs; o++) {
+        for (int k = o; k > 0 && distinct[k] < distinct[k - 1]; k--) {
+            int t = distinct[k];
+            distinct[k] = distinct[k - 1];
+            distinct[k - 1] = t;
+            t = g->objids[k];
+            g->objids[k] = g->objids[k - 1];
+            g->objids[k - 1] = t;
+        }
+    }
+}
+
+/**
+ * @brief The facing a move leaves its object in if it passes
+ *
+ * @param mi The move
+ * @return The direction, or -1 if more than one direction passes
+ */
+static int Move_NeededFacing(const struct move_info *mi)
+{
+    int facing = -1;
+
+    for (int d = 0; d < 4; d++) {
+        if (mi->dir[d] == DIRECTION_NEEDED) {
+            if (facing >= 0) {
+                return -1;
+            }
+            facing = d;
+        }
+    }
+    return facing;
+}
+
+/**
+ * @brief List the decisions of a path in the order the trie makes them
+ *
+ * By default that is one object at a time, in the group's slot order. An
+ * order from Order_Checks() can decide a move before the one before it,
+ * from the only facing that move can pass with.
+ *
+ * @param p The path
+ * @param g The path's group
+ * @param out Set to the decisions, to be freed
+ * @return The number of decisions
+ */
+static int Path_Decisions(int p, const struct trie_group *g, struct trie_decision **out)
+{
+    int first = Paths.obj_first[p], n = 0;
+
+    for (int o = first; o < first + Paths.obj_count[p]; o++) {
+        n += Paths.move_count[o];
+    }
+    *out = calloc(max(n, 1), sizeof(**out));
+    n = 0;
+    if (!Paths.order_first) {
+        for (int slot = 0; slot < g->nobjs; slot++) {
+            int m, count = Path_Moves(p, g->objids[slot], &m);
+            for (int i = 0; i < count; i++) {
+                (*out)[n++] = (struct trie_decision) {
+                    .slot = slot, .move = i, .m = m + i, .facing = -1,
+                };
+            }
+        }
+        return n;
+    }
+
+    for (int k = Paths.order_first[p]; k < Paths.order_first[p + 1]; k++) {
+        int o = Paths.order_obj[k], i = Paths.order_move[k];
+        struct trie_decision d = { .move = i, .m = Paths.move_first[o] + i, .facing = -1 };
+
+        while (g->objids[d.slot] != Paths.objid[o]) {
+            d.slot++;
+        }
+        if (i > 0) {
+            int j;
+            for (j = Paths.order_first[p]; j < k; j++) {
+                if (Paths.order_obj[j] == o && Paths.order_move[j] == i - 1) {
+                    break;
+                }
+            }
+            if (j == k) {
+                d.facing = Move_NeededFacing(&Paths.move[d.m - 1]);
+            }
+        }
+        (*out)[n++] = d;
+    }
+    return n;
+}
+
+/**
+ * @brief Walk a trie node's subtree for every lane at once
+ *
+ * Every object has a facing register per move, the facing it makes the
+ * move from. A node reads its move's register, unless it decides from a
+ * fixed facing, and writes the next one. The move before it is always an
+ * ancestor, so the registers it reads are up to date.
+ *
+ * @param n The node, which every lane in alive has passed
+ * @param W The stream, positioned at the pools of the block
+ * @param bases The stream offset of the RandomN byte of every slot
+ * @param alive The lanes that are still good frames
+ * @param f0 Bit 0 of the facing registers
+ * @param f1 Bit 1 of the facing registers
+ * @param masks Set to the lanes that were good frames for each path
+ * @return void
+ */
+static void Trie_Walk(const struct trie_node *n, const slice_t *W, const int *bases,
+                      slice_t alive, slice_t *f0, slice_t *f1, slice_t *masks)
+{
+    for (int p = 0; p < n->npaths; p++) {
+        masks[n->paths[p]] = alive;
+    }
+    for (int c = 0; c < n->nchildren; c++) {
+        const struct trie_node *ch = n->children[c];
+        slice_t s0 = f0[ch->reg], s1 = f1[ch->reg], a;
+
+        if (ch->facing >= 0) {
+            s0 = (ch->facing & 1)? ~(slice_t){ 0 }: (slice_t){ 0 };
+            s1 = (ch->facing & 2)? ~(slice_t){ 0 }: (slice_t){ 0 };
+        }
+        f0[ch->reg + 1] = s0;
+        f1[ch->reg + 1] = s1;
+        a = alive & Sliced_March(&ch->sm, W + bases[ch->slot] + ch->tick,
+                                 &f0[ch->reg + 1], &f1[ch->reg + 1]);
+
+        FUNNEL_NODE(ch->id, alive, a, alive & Sliced_Retried(&ch->sm, W + bases[ch->slot] + ch->tick, s0, s1));
+        if (Slice_Any(a)) {
+            Trie_Walk(ch, W, bases, a, f0, f1, masks);
+        }
+    }
+}
+
+/**
+ * @brief Bit-sliced CheckGoodMovement of every path for every lane at once
+ *
+ * @param W The stream, positioned at the pools of the block
+ * @param lanes The lanes to check, the frames of the block that are scanned
+ * @param masks Set to the lanes that were good frames for each path
+ * @return void
+ */
+static void Sliced_Check(const slice_t *W, slice_t lanes, slice_t *masks)
+{
+    for (int p = 0; p < Paths.npaths; p++) {
+        masks[p] = (slice_t){ 0 };
+    }
+    for (int t = 0; t < Trie_NumGroups; t++) {
+        const struct trie_group *g = &Trie_Groups[t];
+        slice_t f0[g->nobjs * Trie_Regs], f1[g->nobjs * Trie_Regs];
+        int bases[NUM_OBJECTS];
+
+        // Face the bros on the current frame
+        for (int o = 0; o < g->nobjs; o++) {
+            bases[o] = SLICE_RANDOMN_BIT(g->objids[o], 0);
+            f0[o * Trie_Regs] = W[bases[o]];
+            f1[o * Trie_Regs] = W[bases[o] + 1];
+        }
+        Trie_Walk(&g->root, W, bases, lanes, f0, f1, masks);
+    }
+}
+
+/**
+ * @brief Compile every path into the trie for the bit-sliced checks
+ *
+ * Must be called after Compile_Paths().
+ *
+ * @return void
+ */
+static void Sliced_Init(void)
+{
+    for (int p = 0; p < Paths.npaths; p++) {
+        struct trie_group *g;
+        int t;
+
+        for (t = 0; t < Trie_NumGroups; t++) {
+            if (Trie_Groups[t].face_to_move_frames == Path_FaceToMove(p)) {
+                break;
+            }
+        }
+        if (t == Trie_NumGroups) {
+            Trie_Groups = realloc(Trie_Groups, (Trie_NumGroups + 1) * sizeof(*Trie_Groups));
+            Trie_Groups[Trie_NumGroups++] = (struct trie_group) {
+                .face_to_move_frames = Path_FaceToMove(p),
+            };
+        }
+        g = &Trie_Groups[t];
+        // Every object any path of the group moves gets a slot
+        for (int o = Paths.obj_first[p]; o < Paths.obj_first[p] + Paths.obj_count[p]; o++) {
+            int k;
+            for (k = 0; k < g->nobjs && g->objids[k] != Paths.objid[o]; k++) {
+            }
+            if (k == g->nobjs) {
+                g->objids[g->nobjs++] = Paths.objid[o];
+            }
+        }
+    }
+
+    for (int t = 0; t < Trie_NumGroups; t++) {
+        Trie_OrderObjects(&Trie_Groups[t]);
+    }
+
+    for (int o = 0; o < Paths.nobjs; o++) {
+        Trie_Regs = max(Trie_Regs, Paths.move_count[o] + 1);
+    }
+    for (int p = 0; p < Paths.npaths; p++) {
+        struct trie_group *g = Trie_Groups;
+        struct trie_node *n;
+        struct trie_decision *d;
+        int nd;
+
+        while (g->face_to_move_frames != Path_FaceToMove(p)) {
+            g++;
+        }
+        n = &g->root;
+        nd = Path_Decisions(p, g, &d);
+        for (int k = 0; k < nd; k++) {
+            n = Trie_Child(n, g, &d[k]);
+        }
+        free(d);
+        n->paths = realloc(n->paths, (n->npaths + 1) * sizeof(*n->paths));
+        n->paths[n->npaths++] = p;
+    }
+
+    // The next block starts SLICE_LANES ticks into the stream
+    Sliced_Ticks = max(Check_Ticks, SLICE_LANES);
+}
+
+static void Trie_FreeNode(struct trie_node *n)
+{
+    for (int c = 0; c < n->nchildren; c++) {
+        Trie_FreeNode(n->children[c]);
+        free(n->children[c]);
+    }
+    free(n->children);
+    free(n->paths);
+}
+
+/**
+ * @brief Free the trie, so Sliced_Init() can build it again in another order
+ *
+ * @return void
+ */
+static void Sliced_Free(void)
+{
+    for (int t = 0; t < Trie_NumGroups; t++) {
+        Trie_FreeNode(&Trie_Groups[t].root);
+    }
+    free(Trie_Groups);
+    Trie_Groups = NULL;
+    Trie_NumGroups = 0;
+    Trie_NumNodes = 0;
+}
+
+/**
+ * Memoised checks
+ *
+ * A path only reads bits 0 and 1 of RandomN[objid] on the checked frame,
+ * for the facing, and bits 0, 1 and 7 on the frames its objects decide on.
+ * Once a decision passes the object faces the one direction the move
+ * needs, so every later decision depends only on the bits it reads itself
+ * (paths with a move that can pass in two directions are left out).
+ * Memo_Init() works these bits out from the compiled tables. It groups the
+ * paths by their face-to-move delay and packs each group's bits into keys
+ * of at most MEMO_KEY_BITS bits, each key covering a chunk of whole steps.
+ * For every key, a chunk's table holds the paths of the group that pass
+ * all of the chunk's decisions. Checking every path of a group is then one
+ * gather and one lookup per chunk, and most frames stop after the first.
+ */
+#define MEMO_KEY_BITS       14
+#define MEMO_MAX_PATHS      64      // per group, one bit each in the tables
+#define MEMO_NODES_PER_GATHER 3     // trie nodes that cost as much as a gather
+
+struct memo_gather {
+    int tick;               // after the checked frame
+    int objid;
+    uint8_t mask;           // the bits of RandomN[objid] that are read
+    int shift;              // where they go in the key
+    uint8_t packed[256];    // RandomN[objid] -> the bits of mask, packed
+};
+
+struct memo_chunk {
+    int first_step;
+    int nsteps;
+    int first_gather;
+    int ngathers;
+    uint64_t *pass;         // per key, the paths of the group that pass
+};
+
+struct memo_group {
+    int face_to_move_frames;
+    int npaths;
+    int paths[MEMO_MAX_PATHS];
+    int nsteps;
+    int nchunks;
+    struct memo_chunk *chunks;
+    int ngathers;
+    struct memo_gather *gathers;
+};
+
+static struct memo_group *Memo_Groups;
+static int Memo_NumGroups;
+static bool *Memo_Path;     // per path, whether a memo group checks it
+static bool Memo_All;       // whether Memo_Fill() can check every path
+static bool Memo_Use;       // whether the scans use it
+static int *Memo_Facing;    // per move, see Memo_MoveFacing()
+
+/**
+ * @brief The bits of RandomN whose value can change whether a compiled
+ * move passes, from any facing
+ */
+static uint8_t Memo_MoveBits(const march_lut_t lut)
+{
+    uint8_t bits = 0;
+
+    for (int idx = 0; idx < MARCH_LUT_SIZE; idx++) {
+        for (int b = 0; b < 8; b++) {
+            if ((lut[idx] ^ lut[idx ^ (1 << b)]) & MARCH_NEEDED) {
+                bits |= 1 << b;
+            }
+        }
+    }
+    return bits;
+}
+
+/**
+ * @brief The direction an object faces after passing a compiled move
+ *
+ * @return The direction, or -1 if it depends on the frame
+ */
+static int Memo_MoveFacing(const march_lut_t lut)
+{
+    int facing = -1;
+
+    for (int idx = 0; idx < MARCH_LUT_SIZE; idx++) {
+        if (lut[idx] & MARCH_NEEDED) {
+            if (facing >= 0 && facing != (lut[idx] & 3)) {
+                return -1;
+            }
+            facing = lut[idx] & 3;
+        }
+    }
+    // A move that never passes leaves nothing after it to face for
+    return max(facing, 0);
+}
+
+/**
+ * @brief Whether the decisions of a path after its first step only depend
+ * on the bits they read
+ */
+static bool Memo_CanCheck(int p)
+{
+    for (int o = Paths.obj_first[p]; o < Paths.obj_first[p] + Paths.obj_count[p]; o++) {
+        for (int i = 0; i + 1 < Paths.move_count[o]; i++) {
+            if (Memo_Facing[Paths.move_first[o] + i] < 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Add the bits of a byte to a group's gathers, merging them into the
+ * gather of the same byte if the step being added already has one
+ *
+ * @return The number of new bits
+ */
+static int Memo_Gather(struct memo_group *g, int first, int tick, int objid, uint8_t mask)
+{
+    int before;
+
+    for (int k = first; k < g->ngathers; k++) {
+        struct memo_gather *mg = &g->gathers[k];
+
+        if (mg->tick == tick && mg->objid == objid) {
+            before = __builtin_popcount(mg->mask);
+            mg->mask |= mask;
+            return __builtin_popcount(mg->mask) - before;
+        }
+    }
+    g->gathers = realloc(g->gathers, (g->ngathers + 1) * sizeof(*g->gathers));
+    g->gathers[g->ngathers++] = (struct memo_gather) {
+        .tick = tick,
+        .objid = objid,
+        .mask = mask,
+    };
+    return __builtin_popcount(mask);
+}
+
+/**
+ * @brief Add the gathers of one step of every path of a group
+ *
+ * The bytes a step reads are 32 ticks away from those of any other step,
+ * so steps never share a gather and a chunk's gathers are those of its
+ * steps.
+ *
+ * @return The number of bits the step reads
+ */
+static int Memo_AddStep(struct memo_group *g, int step)
+{
+    int first = g->ngathers;
+    int bits = 0;
+
+    for (int j = 0; j < g->npaths; j++) {
+        int p = g->paths[j];
+
+        for (int o = Paths.obj_first[p]; o < Paths.obj_first[p] + Paths.obj_count[p]; o++) {
+            if (step >= Paths.move_count[o]) {
+                continue;
+            }
+            if (step == 0) {
+                bits += Memo_Gather(g, first, 0, Paths.objid[o], 3);
+            }
+            bits += Memo_Gather(g, first, g->face_to_move_frames + NUM_FRAMES_FOR_ONE_MOVE * step,
+                                Paths.objid[o], Memo_MoveBits(Paths.lut[Paths.move_first[o] + step]));
+        }
+    }
+    return bits;
+}
+
+/**
+ * @brief Fill in the table of a chunk
+ *
+ * Bits a key leaves out are 0, which is as good as any other value since
+ * no decision of the chunk reads them.
+ *
+ * @param g The group
+ * @param c The chunk, with its steps and gathers
+ * @return void
+ */
+static void Memo_FillChunk(struct memo_group *g, struct memo_chunk *c)
+{
+    int nbits = 0;
+
+    for (int k = c->first_gather; k < c->first_gather + c->ngathers; k++) {
+        struct memo_gather *mg = &g->gathers[k];
+
+        mg->shift = nbits;
+        for (int v = 0; v < 256; v++) {
+            int out = 0;
+            for (int b = 0, n = 0; b < 8; b++) {
+                if (mg->mask & (1 << b)) {
+                    out |= !!(v & (1 << b)) << n++;
+                }
+            }
+            mg->packed[v] = out;
+        }
+        nbits += __builtin_popcount(mg->mask);
+    }
+
+    c->pass = calloc(1 << nbits, sizeof(*c->pass));
+    for (int key = 0; key < (1 << nbits); key++) {
+        // RandomN[objid] on the frame of each gather
+        uint8_t bytes[c->ngathers];
+
+        for (int k = 0; k < c->ngathers; k++) {
+            const struct memo_gather *mg = &g->gathers[c->first_gather + k];
+            int n = 0;
+
+            bytes[k] = 0;
+            for (int b = 0; b < 8; b++) {
+                if (mg->mask & (1 << b)) {
+                    bytes[k] |= !!(key & (1 << (mg->shift + n++))) << b;
+                }
+            }
+        }
+
+        for (int j = 0; j < g->npaths; j++) {
+            int p = g->paths[j];
+            bool pass = true;
+
+            for (int o = Paths.obj_first[p]; o < Paths.obj_first[p] + Paths.obj_count[p]; o++) {
+                for (int s = c->first_step; s < c->first_step + c->nsteps && s < Paths.move_count[o]; s++) {
+                    int tick = g->face_to_move_frames + NUM_FRAMES_FOR_ONE_MOVE * s;
+                    int m = Paths.move_first[o] + s;
+                    int facing = -1, random = -1;
+
+                    for (int k = 0; k < c->ngathers; k++) {
+                        const struct memo_gather *mg = &g->gathers[c->first_gather + k];
+
+                        if (mg->objid == Paths.objid[o]) {
+                            if (mg->tick == 0) {
+                                facing = bytes[k] & 3;
+                            }
+                            if (mg->tick == tick) {
+                                random = bytes[k];
+                            }
+                        }
+                    }
+                    if (s) {
+                        facing = Memo_Facing[m - 1];
+                    }
+                    pass = pass && (Paths.lut[m][facing << 8 | random] & MARCH_NEEDED);
+                }
+            }
+            c->pass[key] |= (uint64_t)pass << j;
+        }
+    }
+}
+
+/**
+ * @brief Build the memo groups of every path that can be memoised
+ *
+ * The scans use them instead of the bit-sliced checks if every path can be
+ * memoised and the trie is big enough for that to pay off, which is when
+ * there are many paths with the same objects.
+ *
+ * Must be called after Sliced_Init().
+ *
+ * @return void
+ */
+static void Memo_Init(void)
+{
+    int gathers = 0;
+
+    Memo_Facing = calloc(max(Paths.nmoves, 1), sizeof(*Memo_Facing));
+    for (int m = 0; m < Paths.nmoves; m++) {
+        Memo_Facing[m] = Memo_MoveFacing(Paths.lut[m]);
+    }
+    Memo_Path = calloc(max(Paths.npaths, 1), sizeof(*Memo_Path));
+    for (int p = 0; p < Paths.npaths; p++) {
+        struct memo_group *g = NULL;
+
+        if (!Memo_CanCheck(p)) {
+            continue;
+        }
+        for (int t = 0; t < Memo_NumGroups; t++) {
+            if (Memo_Groups[t].face_to_move_frames == Path_FaceToMove(p) &&
+                Memo_Groups[t].npaths < MEMO_MAX_PATHS) {
+                g = &Memo_Groups[t];
+            }
+        }
+        if (!g) {
+            Memo_Groups = realloc(Memo_Groups, (Memo_NumGroups + 1) * sizeof(*Memo_Groups));
+            g = &Memo_Groups[Memo_NumGroups++];
+            *g = (struct memo_group) { .face_to_move_frames = Path_FaceToMove(p) };
+        }
+        g->paths[g->npaths++] = p;
+        for (int o = Paths.obj_first[p]; o < Paths.obj_first[p] + Paths.obj_count[p]; o++) {
+            g->nsteps = max(g->nsteps, Paths.move_count[o]);
+        }
+    }
+
+    for (int t = 0; t < Memo_NumGroups; t++) {
+        struct memo_group *g = &Memo_Groups[t];
+        int step_gather[g->nsteps + 1], step_bits[g->nsteps];
+        int s;
+
+        for (s = 0; s < g->nsteps; s++) {
+            step_gather[s] = g->ngathers;
+            step_bits[s] = Memo_AddStep(g, s);
+        }
+        step_gather[g->nsteps] = g->ngathers;
+
+        // As many whole steps to a chunk as fit in a key
+        for (s = 0; s < g->nsteps; ) {
+            struct memo_chunk c = { .first_step = s, .first_gather = step_gather[s] };
+            int bits = 0;
+
+            while (s < g->nsteps && bits + step_bits[s] <= MEMO_KEY_BITS) {
+                bits += step_bits[s++];
+                c.nsteps++;
+            }
+            if (!c.nsteps) {
+                break;
+            }
+            c.ngathers = step_gather[s] - c.first_gather;
+            Memo_FillChunk(g, &c);
+            g->chunks = realloc(g->chunks, (g->nchunks + 1) * sizeof(*g->chunks));
+            g->chunks[g->nchunks++] = c;
+        }
+        // Unless a step reads too many bits for a key
+        if (s < g->nsteps) {
+            continue;
+        }
+        for (int j = 0; j < g->npaths; j++) {
+            Memo_Path[g->paths[j]] = true;
+        }
+        gathers += g->ngathers;
+    }
+
+    Memo_All = Check_Ticks + 64 <= RNG_RING_SIZE;
+    for (int p = 0; p < Paths.npaths; p++) {
+        Memo_All = Memo_All && Memo_Path[p];
+    }
+    Memo_Use = Memo_All && Trie_NumNodes > MEMO_NODES_PER_GATHER * gathers;
+#ifdef SMB3RNG_FUNNEL
+    // The funnel counts the decisions of the trie
+    Memo_Use = false;
+#endif
+}
+
+/**
+ * @brief The paths of a group that pass on a frame
+ *
+ * @param g The group
+ * @param r A ring holding the pools of iteration up to Check_Ticks later
+ * @param iteration The iteration of the RNG we're checking
+ * @return Bit j set if the group's path j passes
+ */
+static inline uint64_t Memo_Check(const struct memo_group *g, const struct rng_ring *r, int64_t iteration)
+{
+    uint64_t pass = g->npaths < 64? (1ULL << g->npaths) - 1: ~0ULL;
+
+    for (int c = 0; c < g->nchunks && pass; c++) {
+        const struct memo_chunk *mc = &g->chunks[c];
+        unsigned key = 0;
+
+        for (int k = mc->first_gather; k < mc->first_gather + mc->ngathers; k++) {
+            const struct memo_gather *mg = &g->gathers[k];
+            key |= mg->packed[POOL_RANDOMN(RNG_Ring_Pool(r, iteration + mg->tick), mg->objid)] << mg->shift;
+        }
+        pass &= mc->pass[key];
+    }
+    return pass;
+}
+
+/**
+ * @brief Transpose a 64x64 bit matrix in place
+ *
+ * @param m The rows, bit j of row i ends up as bit i of row j
+ * @return void
+ */
+static void Bits_Transpose64(uint64_t m[64])
+{
+    uint64_t mask = 0x00000000ffffffffULL;
+
+    for (int w = 32; w; w >>= 1, mask ^= mask << w) {
+        for (int i = 0; i < 64; i = (i + w + 1) & ~w) {
+            uint64_t t = ((m[i] >> w) ^ m[i + w]) & mask;
+            m[i] ^= t << w;
+            m[i + w] ^= t;
+        }
+    }
+}
+
+/**
+ * @brief Check every path over the next frames of a ring into success
+ * bitsets
+ *
+ * Each group's masks of 64 frames are transposed into a word of every one
+ * of its paths, however many paths there are. The ring has to hold the
+ * pools of 64 frames and their Check_Ticks, see Memo_Use.
+ *
+ * @param r The ring, its first frame is the first to check, it is advanced
+ *        past the frames
+ * @param bits Set to one bitset per path, see Bitset_Words() for their size
+ * @param frames The number of frames
+ * @return void
+ */
+static void Memo_Fill(struct rng_ring *r, uint64_t *const *bits, int frames)
+{
+    int64_t first = r->next - RNG_RING_SIZE;
+    uint64_t m[64];
+
+    for (int i = 0; i < frames; i += 64) {
+        int n = min(frames - i, 64);
+
+        for (int t = 0; t < Memo_NumGroups; t++) {
+            const struct memo_group *g = &Memo_Groups[t];
+
+            for (int k = 0; k < 64; k++) {
+                m[k] = k < n? Memo_Check(g, r, first + i + k): 0;
+            }
+            Bits_Transpose64(m);
+            for (int j = 0; j < g->npaths; j++) {
+                bits[g->paths[j]][i / 64] = m[j];
+            }
+        }
+        for (int k = 0; k < n; k++) {
+            RNG_Ring_Advance(r);
+        }
+    }
+    for (int w = (frames + 63) / 64; w < Bitset_Words(frames); w++) {
+        for (int p = 0; p < Paths.npaths; p++) {
+            bits[p][w] = 0;
+        }
+    }
+}
+
+#ifdef SMB3RNG_FUNNEL
+static struct funnel_block *Funnel_Blocks;
+static pthread_mutex_t Funnel_Lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void Funnel_Row(int objid, int move, const struct funnel_count *c)
+{
+    fprintf(stderr, "    %-9s move %d: %" PRIu64 " reached, %" PRIu64 " passed, %" PRIu64 " failed, %" PRIu64 " retried\n",
+            Object_Name(objid), move, c->reached, c->passed, c->reached - c->passed, c->retried);
+}
+
+/**
+ * @brief Sum the blocks of every thread and print each path's funnel
+ *
+ * The reference checks decide move by move and the bit-sliced ones object
+ * by object, so each prints in its own order. The bit-sliced checks count
+ * whole blocks, the lanes past the end of a scan included.
+ *
+ * @return void
+ */
+static void Funnel_Print(void)
+{
+    struct funnel_count *moves = calloc(Paths.nmoves, sizeof(*moves));
+    struct funnel_count *nodes = calloc(Trie_NumNodes, sizeof(*nodes));
+
+    for (const struct funnel_block *b = Funnel_Blocks; b; b = b->next) {
+        for (int m = 0; m < Paths.nmoves; m++) {
+            moves[m].reached += b->moves[m].reached;
+            moves[m].passed += b->moves[m].passed;
+            moves[m].retried += b->moves[m].retried;
+        }
+        for (int n = 0; n < Trie_NumNodes; n++) {
+            nodes[n].reached += b->nodes[n].reached;
+            nodes[n].passed += b->nodes[n].passed;
+            nodes[n].retried += b->nodes[n].retried;
+        }
+    }
+
+    for (int p = 0; p < Paths.npaths; p++) {
+        const struct trie_group *g = Trie_Groups;
+        struct trie_node *n;
+        struct trie_decision *d;
+        int first = Paths.obj_first[p], last = first + Paths.obj_count[p], nmoves = 0, nd;
+
+        for (int o = first; o < last; o++) {
+            nmoves = max(nmoves, Paths.move_count[o]);
+        }
+        if (moves[Paths.move_first[first]].reached) {
+            fprintf(stderr, "Funnel for %s, reference checks:\n", Paths.name[p]);
+            for (int i = 0; i < nmoves; i++) {
+                for (int o = first; o < last; o++) {
+                    if (i < Paths.move_count[o]) {
+                        Funnel_Row(Paths.objid[o], i + 1, &moves[Paths.move_first[o] + i]);
+                    }
+                }
+            }
+        }
+
+        // The path's nodes, the way Sliced_Init() added them
+        if (!Trie_NumGroups) {
+            continue;
+        }
+        while (g->face_to_move_frames != Path_FaceToMove(p)) {
+            g++;
+        }
+        n = (struct trie_node *)&g->root;
+        nd = Path_Decisions(p, g, &d);
+        for (int k = 0; k < nd; k++) {
+            n = Trie_Child(n, g, &d[k]);
+            if (!k && !nodes[n->id].reached) {
+                break;
+            }
+            if (!k) {
+                fprintf(stderr, "Funnel for %s, bit-sliced checks:\n", Paths.name[p]);
+            }
+            Funnel_Row(g->objids[d[k].slot], d[k].move + 1, &nodes[n->id]);
+        }
+        free(d);
+    }
+    free(moves);
+    free(nodes);
+}
+
+static struct funnel_block *Funnel_New(void)
+{
+    struct funnel_block *b = calloc(1, sizeof(*b));
+
+    b->moves = calloc(Paths.nmoves, sizeof(*b->moves));
+    b->nodes = calloc(Trie_NumNodes, sizeof(*b->nodes));
+    pthread_mutex_lock(&Funnel_Lock);
+    if (!Funnel_Blocks) {
+        atexit(Funnel_Print);
+    }
+    b->next = Funnel_Blocks;
+    Funnel_Blocks = b;
+    pthread_mutex_unlock(&Funnel_Lock);
+    return b;
+}
+#endif /* SMB3RNG_FUNNEL */
+
+/**
+ * Check order
+ *
+ * The trie decides the moves of a path one object at a time. With -O, a
+ * sample of frames measures how often each decision passes, and every path
+ * is decided most selective decision first instead, so that frames fail
+ * after fewer decisions on average. A move is decided from the facing the
+ * move before it left, so it can only go first if a single direction of
+ * the move before passes: any frame the path passes on has that facing.
+ * Every path still passes on exactly the frames it did. The memoised scans
+ * don't walk the trie, so when Memo_Use is set -O is skipped.
+ */
+#define ORDER_SAMPLE_FRAMES     4096
+// Pass rates closer than this are a tie, which keeps the default order
+#define ORDER_RATE_MARGIN       0.02
+
+/**
+ * @brief Make a path's decisions on a frame in an order, until one fails
+ *
+ * @param r A ring holding the pools of iteration up to Check_Ticks later
+ * @param iteration The iteration to check
+ * @param p The path
+ * @param obj The object of each decision, in the objects table
+ * @param move The object's move index of each decision
+ * @param n The number of decisions
+ * @return The number of decisions made
+ */
+static int Order_Decisions(const struct rng_ring *r, int64_t iteration, int p,
+                           const int *obj, const int *move, int n)
+{
+    int facing[Paths.nmoves];
+    int f2m = Paths.face_to_move_frames[Paths.level[p]];
+
+    for (int k = 0; k < n; k++) {
+        int o = obj[k], i = move[k], m = Paths.move_first[o] + i;
+        int objid = Paths.objid[o];
+        int j, f;
+        uint8_t d;
+
+        for (j = 0; j < k && (obj[j] != o || move[j] != i - 1); j++) {
+        }
+        if (i == 0) {
+            f = POOL_RANDOMN(RNG_Ring_Pool(r, iteration), objid) & 3;
+        } else if (j < k) {
+            f = facing[m - 1];
+        } else {
+            f = Move_NeededFacing(&Paths.move[m - 1]);
+        }
+        d = Paths.lut[m][f << 8 | POOL_RANDOMN(RNG_Ring_Pool(r, iteration + f2m + NUM_FRAMES_FOR_ONE_MOVE * i), objid)];
+        if (!(d & MARCH_NEEDED)) {
+            return k + 1;
+        }
+        facing[m] = d & 3;
+    }
+    return n;
+}
+
+/**
+ * @brief Order the decisions of every path by how selective they are
+ *
+ * @param start_frame The first frame of the sample
+ * @return void
+ */
+static void Order_Checks(int64_t start_frame)
+{
+    static struct rng_ring ring;
+    uint64_t *reached = calloc(Paths.nmoves, sizeof(*reached));
+    uint64_t *passed = calloc(Paths.nmoves, sizeof(*passed));
+    uint8_t pool[9];
+    int total = 0;
+
+    for (int o = 0; o < Paths.nobjs; o++) {
+        total += Paths.move_count[o];
+    }
+
+    memcpy(pool, Random_Pool, sizeof(pool));
+    Randomize_Pool_N(pool, start_frame - 13);
+    RNG_Ring_Init(&ring, pool, start_frame);
+
+    // Pass rates, of every move from any facing it can pass from
+    for (int64_t i = start_frame; i < start_frame + ORDER_SAMPLE_FRAMES; i++, RNG_Ring_Advance(&ring)) {
+        for (int p = 0; p < Paths.npaths; p++) {
+            int64_t tick = i + Paths.face_to_move_frames[Paths.level[p]];
+
+            for (int o = Paths.obj_first[p]; o < Paths.obj_first[p] + Paths.obj_count[p]; o++) {
+                const struct move_info *mi = &Paths.move[Paths.move_first[o]];
+                const march_lut_t *lut = &Paths.lut[Paths.move_first[o]];
+                int objid = Paths.objid[o];
+                int f = POOL_RANDOMN(RNG_Ring_Pool(&ring, i), objid) & 3;
+
+                for (int k = 0; k < Paths.move_count[o]; k++) {
+                    uint8_t d;
+
+                    if (f < 0 && (f = Move_NeededFacing(&mi[k - 1])) < 0) {
+                        continue;
+                    }
+                    d = lut[k][f << 8 | POOL_RANDOMN(RNG_Ring_Pool(&ring, tick + NUM_FRAMES_FOR_ONE_MOVE * k), objid)];
+                    reached[Paths.move_first[o] + k]++;
+                    passed[Paths.move_first[o] + k] += !!(d & MARCH_NEEDED);
+                    f = (d & MARCH_NEEDED)? d & 3: -1;
+                }
+            }
+        }
+    }
+
+    Paths.order_first = calloc(Paths.npaths + 1, sizeof(*Paths.order_first));
+    Paths.order_obj = calloc(max(total, 1), sizeof(*Paths.order_obj));
+    Paths.order_move = calloc(max(total, 1), sizeof(*Paths.order_move));
+
+    for (int p = 0, k = 0; p < Paths.npaths; p++) {
+        int first = Paths.obj_first[p], last = first + Paths.obj_count[p];
+        int nmoves = 0, n = 0;
+        int ref_obj[total], ref_move[total];
+        bool placed[Paths.nmoves];
+        uint64_t before = 0, after = 0;
+
+        Paths.order_first[p] = k;
+        memset(placed, 0, sizeof(placed));
+        for (int o = first; o < last; o++) {
+            nmoves = max(nmoves, Paths.move_count[o]);
+        }
+        // The order CheckGoodMovement() decides in, which breaks ties
+        for (int i = 0; i < nmoves; i++) {
+            for (int o = first; o < last; o++) {
+                if (i < Paths.move_count[o]) {
+                    ref_obj[n] = o;
+                    ref_move[n++] = i;
+                }
+            }
+        }
+        for (int placing = 0; placing < n; placing++) {
+            int best = -1;
+            double best_rate = 2;
+
+            for (int c = 0; c < n; c++) {
+                int m = Paths.move_first[ref_obj[c]] + ref_move[c];
+                double rate = reached[m]? (double)passed[m] / reached[m]: 1;
+
+                if (placed[m] || (ref_move[c] && !placed[m - 1] &&
+                                  Move_NeededFacing(&Paths.move[m - 1]) < 0)) {
+                    continue;
+                }
+                if (rate < best_rate - ORDER_RATE_MARGIN) {
+                    best = c;
+                    best_rate = rate;
+                }
+            }
+            placed[Paths.move_first[ref_obj[best]] + ref_move[best]] = true;
+            Paths.order_obj[k + placing] = ref_obj[best];
+            Paths.order_move[k + placing] = ref_move[best];
+        }
+
+        RNG_Ring_Init(&ring, pool, start_frame);
+        for (int64_t i = start_frame; i < start_frame + ORDER_SAMPLE_FRAMES; i++, RNG_Ring_Advance(&ring)) {
+            before += Order_Decisions(&ring, i, p, ref_obj, ref_move, n);
+            after += Order_Decisions(&ring, i, p, &Paths.order_obj[k], &Paths.order_move[k], n);
+        }
+        fprintf(stderr, "Check order for %s:", Paths.name[p]);
+        for (int c = k; c < k + n; c++) {
+            int m = Paths.move_first[Paths.order_obj[c]] + Paths.order_move[c];
+            fprintf(stderr, " %s %d (%.0f%%)", Object_Name(Paths.objid[Paths.order_obj[c]]),
+                    Paths.order_move[c] + 1, reached[m]? 100.0 * passed[m] / reached[m]: 100.0);
+        }
+        fprintf(stderr, ", %.2f -> %.2f decisions per frame\n",
+                (double)before / ORDER_SAMPLE_FRAMES, (double)after / ORDER_SAMPLE_FRAMES);
+        k += n;
+    }
+    Paths.order_first[Paths.npaths] = total;
+    free(reached);
+    free(passed);
+}
+
+/**
+ * @brief Start a bit-sliced stream
+ *
+ * @param pool The Random_Pool one tick before the first frame, it is clobbered
+ * @return The stream, holding the pools of the first block
+ */
+static slice_t *Sliced_Start(uint8_t *pool)
+{
+    slice_t *W = aligned_alloc(sizeof(slice_t), sizeof(slice_t) * (RNG_BITS + Sliced_Ticks));
+    struct rng_state s = RNG_Load(pool);
+
+    // Transpose the first block, every later block comes from the stream
+    memset(W, 0, sizeof(slice_t) * RNG_BITS);
+    for (int j = 0; j < SLICE_LANES; j++) {
+        s = RNG_Tick(s);
+        for (uint64_t m = s.lo; m; m &= m - 1) {
+            Slice_SetLane(&W[__builtin_ctzll(m)], j);
+        }
+        for (unsigned m = s.hi; m; m &= m - 1) {
+            Slice_SetLane(&W[64 + __builtin_ctz(m)], j);
+        }
+    }
+    RNG_Store(s, pool);
+    return W;
+}
+
+/**
+ * @brief Generate the rest of the stream every path of the block reads
+ */
+static inline void Sliced_Extend(slice_t *W)
+{
+    for (int k = RNG_BITS; k < RNG_BITS + Sliced_Ticks; k++) {
+        W[k] = W[k - 7] ^ W[k - 15];
+    }
+}
+
+/**
+ * @brief Move the stream on to the pools of the next block
+ */
+static inline void Sliced_Next(slice_t *W)
+{
+    memmove(W, W + SLICE_LANES, sizeof(slice_t) * RNG_BITS);
+}
+
+/**
+ * Success bitsets
+ *
+ * The bit-sliced checks give a success bitset per path, bit i set if frame
+ * i was good. Windows are found from them in a separate pass that works a
+ * word at a time, and only frames that end a window are looked at one at
+ * a time, to get their pool.
+ */
+#define SCAN_CHUNK_FRAMES   (1 << 16)   // frames Sliced_Scan() checks before finding their windows
+
+/**
+ * A window of good frames found in a success bitset
+ */
+struct window_run {
+    int first;      // the bit of its first good frame
+    int len;
+};
+
+/**
+ * @brief Gather the even bits of a word into its low half and the odd bits
+ * into its high half
+ */
+static inline uint64_t Bits_Deinterleave(uint64_t x)
+{
+    uint64_t e = x & 0x5555555555555555ULL, o = (x >> 1) & 0x5555555555555555ULL;
+
+    e = (e | e >> 1) & 0x3333333333333333ULL;
+    o = (o | o >> 1) & 0x3333333333333333ULL;
+    e = (e | e >> 2) & 0x0f0f0f0f0f0f0f0fULL;
+    o = (o | o >> 2) & 0x0f0f0f0f0f0f0f0fULL;
+    e = (e | e >> 4) & 0x00ff00ff00ff00ffULL;
+    o = (o | o >> 4) & 0x00ff00ff00ff00ffULL;
+    e = (e | e >> 8) & 0x0000ffff0000ffffULL;
+    o = (o | o >> 8) & 0x0000ffff0000ffffULL;
+    e = (e | e >> 16) & 0x00000000ffffffffULL;
+    o = (o | o >> 16) & 0x00000000ffffffffULL;
+    return e | o << 32;
+}
+
+/**
+ * @brief Count the set bits of a bitset from bit i on, up to the first clear one
+ *
+ * @param bits The bitset
+ * @param i The first bit
+ * @param words The size of the bitset
+ * @return The number of set bits
+ */
+static inline int Bitset_Ones(const uint64_t *bits, int i, int words)
+{
+    int n = 0;
+
+    for (int w = i / 64, sh = i % 64; w < words; w++, sh = 0) {
+        uint64_t x = ~(bits[w] >> sh);
+        int k;
+
+        if (!x) {
+            n += 64;
+            continue;
+        }
+        k = __builtin_ctzll(x);
+        n += k;
+        if (k < 64 - sh) {
+            break;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Find the windows in a range of a success bitset
+ *
+ * Good frames are strung into windows like update_windows() does: a good
+ * frame continues the window if the last good frame was stride frames
+ * before it, and starts a new one otherwise.
+ *
+ * That is worked out for 64 frames at a time: a frame continues a window
+ * if it and the frame stride before are good and none in between is. The
+ * frames that don't start windows, and the ones that do are then found
+ * with ctz, and the length of each window is the run of continuing frames
+ * after it, which is a run of consecutive bits once a stride of 2 is
+ * de-interleaved into even and odd frames.
+ *
+ * @param bits The bitset
+ * @param a The first bit of the range
+ * @param b The bit the range stops at
+ * @param stride 1, or 2 for forts, whose good frames are counted every other frame
+ * @param runs Set to the windows, in frame order
+ * @return The number of windows
+ */
+static int Bitset_Runs(const uint64_t *bits, int a, int b, int stride, struct window_run **runs)
+{
+    int words = (b - a + 63) / 64;
+    int lane_words = (words + 1) / 2;
+    uint64_t *m = calloc(words + 1, sizeof(*m));
+    uint64_t *cont = calloc(words + 1, sizeof(*cont));
+    uint64_t *lanes[2] = { cont, NULL };
+    int n = 0, size = 0;
+
+    // The range, from bit 0
+    for (int w = 0; w < words; w++) {
+        int lo = a + 64 * w, sh = lo % 64;
+
+        m[w] = bits[lo / 64] >> sh;
+        if (sh && (lo / 64 + 1) * 64 < b) {
+            m[w] |= bits[lo / 64 + 1] << (64 - sh);
+        }
+    }
+    if ((b - a) % 64) {
+        m[words - 1] &= (1ULL << ((b - a) % 64)) - 1;
+    }
+
+    for (int w = 0; w < words; w++) {
+        uint64_t prev = w? m[w - 1]: 0;
+
+        if (stride == 1) {
+            cont[w] = m[w] & (m[w] << 1 | prev >> 63);
+        } else {
+            cont[w] = m[w] & (m[w] << 2 | prev >> 62) & ~(m[w] << 1 | prev >> 63);
+        }
+    }
+    if (stride == 2) {
+        lanes[0] = calloc(lane_words + 1, sizeof(uint64_t));
+        lanes[1] = calloc(lane_words + 1, sizeof(uint64_t));
+        for (int w = 0; w < words; w++) {
+            uint64_t d = Bits_Deinterleave(cont[w]);
+
+            lanes[0][w / 2] |= (d & 0xffffffffULL) << (32 * (w % 2));
+            lanes[1][w / 2] |= (d >> 32) << (32 * (w % 2));
+        }
+    }
+
+    *runs = NULL;
+    for (int w = 0; w < words; w++) {
+        uint64_t starts = m[w] & ~cont[w];
+
+        while (starts) {
+            int i = 64 * w + __builtin_ctzll(starts);
+
+            if (n == size) {
+                size = size? size * 2: 64;
+                *runs = realloc(*runs, size * sizeof(**runs));
+            }
+            (*runs)[n++] = (struct window_run) {
+                .first = a + i,
+                .len = 1 + Bitset_Ones(lanes[i % stride], i / stride + 1,
+                                       stride == 1? words: lane_words),
+            };
+            starts &= starts - 1;
+        }
+    }
+
+    if (stride == 2) {
+        free(lanes[0]);
+        free(lanes[1]);
+    }
+    free(cont);
+    free(m);
+    return n;
+}
+
+/**
+ * A frame whose pool Windows_AddBitsets() needs, because it ends a window
+ * or the shard's bookkeeping keeps its pool
+ */
+struct window_hit {
+    int bit;
+    int path;
+    int len;            // the window it ends, 0 for none
+    int lead_rng;       // the lead_rng it is, -1 for none
+    bool lead;          // the window is in the shard's leading run
+};
+
+static int window_hit_cmp(const void *a, const void *b)
+{
+    const struct window_hit *x = a, *y = b;
+    if (x->bit != y->bit) {
+        return x->bit - y->bit;
+    }
+    return x->path - y->path;
+}
+
+/**
+ * @brief Move a pool on to a later iteration, ticking or jumping
+ *
+ * @param pool The pool
+ * @param at The iteration of the pool, set to to
+ * @param to The iteration to move it to
+ * @return void
+ */
+static void Pool_Advance(uint8_t *pool, int64_t *at, int64_t to)
+{
+    Randomize_Pool_N(pool, to - *at);
+    *at = to;
+}
+
+/**
+ * @brief Update the windows of a scan from the success bitsets of its next
+ * frames
+ *
+ * This leaves ws the same as update_windows() for every good frame in
+ * frame and path order would, fort windows are logged in the same order
+ * too, but it goes a window at a time instead of a frame at a time.
+ *
+ * @param ws The window state to update
+ * @param bits One success bitset per path
+ * @param first The iteration of bit 0, the first after the frames ws has seen
+ * @param frames The number of bits
+ * @param pool The Random_Pool one tick before first, moved on to the one
+ *        one tick before first + frames
+ * @return void
+ */
+static void Windows_AddBitsets(struct scan_windows *ws, uint64_t *const *bits, int64_t first, int frames,
+                               uint8_t *pool)
+{
+    struct window_hit *hits = NULL;
+    int nhits = 0, size = 0;
+    int64_t at = first - 1;
+
+    for (int p = 0; p < Paths.npaths; p++) {
+        int stride = PATH_STRIDE(p);
+        struct window_run *runs;
+        int nruns = Bitset_Runs(bits[p], 0, frames, stride, &runs);
+
+        for (int r = 0; r < nruns; r++) {
+            int64_t eol = Path_EOLFrame(p, first + runs[r].first);
+            int64_t last = eol + (int64_t)(runs[r].len - 1) * stride;
+            int len = runs[r].len;
+            // Only the first run can continue the window of the frames before
+            int carry = (r == 0 && ws->last_good[p] == eol - stride)? ws->windowlen[p]: 0;
+            bool lead = carry == ws->hits[p];
+
+            for (int k = 0; k < len; k++) {
+                bool window = carry + k + 1 >= PATH_MIN_WINDOW(p);
+                bool rng = ws->shard && lead && ws->hits[p] + k < 2;
+
+                if (!window && !rng) {
+                    continue;
+                }
+                if (nhits == size) {
+                    size = size? size * 2: 256;
+                    hits = realloc(hits, size * sizeof(*hits));
+                }
+                hits[nhits++] = (struct window_hit) {
+                    .bit = runs[r].first + k * stride,
+                    .path = p,
+                    .len = window? carry + k + 1: 0,
+                    .lead_rng = rng? ws->hits[p] + k: -1,
+                    .lead = ws->shard && lead,
+                };
+            }
+
+            if (!ws->hits[p]) {
+                ws->lead_eol[p] = eol;
+            }
+            if (lead) {
+                ws->lead_len[p] = ws->hits[p] + len;
+            } else if (carry + len > ws->rest_max[p]) {
+                ws->rest_max[p] = carry + len;
+                ws->rest_frm[p] = last;
+            }
+            if (carry + len > ws->windowmax[p]) {
+                ws->windowmax[p] = carry + len;
+                ws->windowfrm[p] = last;
+            }
+            ws->hits[p] += len;
+            ws->windowlen[p] = carry + len;
+            ws->last_good[p] = last;
+        }
+        free(runs);
+    }
+
+    qsort(hits, nhits, sizeof(*hits), window_hit_cmp);
+    for (int i = 0; i < nhits; i++) {
+        const struct window_hit *h = &hits[i];
+        int64_t eol = Path_EOLFrame(h->path, first + h->bit);
+
+        Pool_Advance(pool, &at, first + h->bit);
+        if (h->lead_rng >= 0) {
+            memcpy(ws->lead_rng[h->path][h->lead_rng], pool, 9);
+        }
+        if (h->len) {
+            struct window_node w = {
+                .window_length = h->len,
+                .eol_frame = eol,
+            };
+
+            memcpy(w.rng, pool, sizeof(w.rng));
+            if (PATH_FORT(h->path) && !ws->shard && !ws->quiet && g_format == OUTPUT_TEXT) {
+                printf("adding window of length %d for level Level %s: %" PRId64 "\n",
+                       h->len, Paths.name[h->path], eol);
+            }
+            Store_Add(h->lead? &ws->lead[h->path]: &ws->windows[h->path], &w);
+        }
+    }
+    Pool_Advance(pool, &at, first + frames - 1);
+    free(hits);
+}
+
+/**
+ * @brief Append the success bitsets of some frames to a file, see Bitsets_Open()
+ *
+ * The bitsets are sparse, so every path stores the gaps between its good
+ * frames, as LEB128 varints.
+ *
+ * @param f The file
+ * @param bits One success bitset per path
+ * @param first The iteration of bit 0
+ * @param frames The number of bits
+ * @return void
+ */
+static void Bitsets_Write(FILE *f, uint64_t *const *bits, int64_t first, int frames)
+{
+    uint8_t *buf = malloc(3 * (size_t)frames + 16);
+    int32_t n32 = frames;
+
+    fwrite(&first, sizeof(first), 1, f);
+    fwrite(&n32, sizeof(n32), 1, f);
+    for (int p = 0; p < Paths.npaths; p++) {
+        uint32_t len = 0;
+        int next = 0;
+
+        for (int w = 0; w < (frames + 63) / 64; w++) {
+            for (uint64_t x = bits[p][w]; x; x &= x - 1) {
+                int i = 64 * w + __builtin_ctzll(x);
+                uint32_t gap = i - next;
+
+                for (; gap >= 0x80; gap >>= 7) {
+                    buf[len++] = gap | 0x80;
+                }
+                buf[len++] = gap;
+                next = i + 1;
+            }
+        }
+        fwrite(&len, sizeof(len), 1, f);
+        fwrite(buf, 1, len, f);
+    }
+    free(buf);
+}
+
+/**
+ * @brief Check every path over the next frames of a stream, keeping only
+ * whether each frame was good
+ *
+ * @param W The stream, moved on past the frames
+ * @param masks Scratch for one slice per path
+ * @param bits One bitset per path, bit i set if frame i was good, see
+ *        Bitset_Words() for their size
+ * @param frames The number of frames
+ * @return void
+ */
+static void Sliced_Fill(slice_t *W, slice_t *masks, uint64_t *const *bits, int frames)
+{
+    // The last block runs past the frames, its lanes past them aren't checked
+    for (int i = 0; i < frames; i += SLICE_LANES) {
+        Sliced_Extend(W);
+        Sliced_Check(W, Slice_FirstLanes(frames - i), masks);
+        for (int p = 0; p < Paths.npaths; p++) {
+            memcpy(&bits[p][i / 64], &masks[p], sizeof(slice_t));
+        }
+        Sliced_Next(W);
+    }
+}
+
+/**
+ * @brief Check every path SLICE_LANES frames at a time
+ *
+ * Results are identical to Reference_Scan(), windows are updated in the
+ * same frame and path order. The frames are checked SCAN_CHUNK_FRAMES at a
+ * time into success bitsets, which are saved to ws->bits_out if it is set,
+ * and then their windows are found. With Memo_Use the bitsets come from
+ * the memoised checks instead.
+ *
+ * @param ws The window state to update
+ * @param pool The Random_Pool one tick before start_frame, it is clobbered
+ * @param start_frame The first iteration to check
+ * @param end_frame The iteration to stop at
+ * @return void
+ */
+static void Sliced_Scan(struct scan_windows *ws, uint8_t *pool, int64_t start_frame, int64_t end_frame)
+{
+    uint8_t before[9];
+    slice_t *W = NULL;
+    slice_t *masks = aligned_alloc(sizeof(slice_t), sizeof(slice_t) * Paths.npaths);
+    struct rng_ring *ring = NULL;
+    uint64_t *bits[Paths.npaths];
+
+    memcpy(before, pool, sizeof(before));
+    if (Memo_Use) {
+        ring = malloc(sizeof(*ring));
+        RNG_Ring_Init(ring, pool, start_frame);
+    } else {
+        W = Sliced_Start(pool);
+    }
+    for (int p = 0; p < Paths.npaths; p++) {
+        bits[p] = malloc(Bitset_Words(SCAN_CHUNK_FRAMES) * sizeof(uint64_t));
+    }
+
+    for (int64_t chunk = start_frame; chunk < end_frame; chunk += SCAN_CHUNK_FRAMES) {
+        int frames = min(end_frame - chunk, (int64_t)SCAN_CHUNK_FRAMES);
+
+        if (ring) {
+            Memo_Fill(ring, bits, frames);
+        } else {
+            Sliced_Fill(W, masks, bits, frames);
+        }
+        if (ws->bits_out) {
+            Bitsets_Write(ws->bits_out, bits, chunk, frames);
+        }
+        Windows_AddBitsets(ws, bits, chunk, frames, before);
+    }
+
+    for (int p = 0; p < Paths.npaths; p++) {
+        free(bits[p]);
+    }
+    free(ring);
+    free(masks);
+    free(W);
+}
+
+/**
+ * @brief Check every path over a range of frames, keeping only whether
+ * each frame was good
+ *
+ * @param pool The Random_Pool one tick before start_frame, it is clobbered
+ * @param start_frame The first iteration to check
+ * @param end_frame The iteration to stop at
+ * @return One bitset per path, bit i set if start_frame + i was good,
+ *         see Bitset_Words() for their size
+ */
+static uint64_t **Sliced_Bitsets(uint8_t *pool, int start_frame, int end_frame)
+{
+    int frames = end_frame - start_frame;
+    uint64_t **bits = calloc(Paths.npaths, sizeof(*bits));
+
+    for (int p = 0; p < Paths.npaths; p++) {
+        bits[p] = calloc(Bitset_Words(frames), sizeof(uint64_t));
+    }
+    if (Memo_Use) {
+        struct rng_ring *ring = malloc(sizeof(*ring));
+
+        RNG_Ring_Init(ring, pool, start_frame);
+        Memo_Fill(ring, bits, frames);
+        free(ring);
+    } else {
+        slice_t *W = Sliced_Start(pool);
+        slice_t *masks = aligned_alloc(sizeof(slice_t), sizeof(slice_t) * Paths.npaths);
+
+        Sliced_Fill(W, masks, bits, frames);
+        free(masks);
+        free(W);
+    }
+    return bits;
+}
+
+/**
+ * @brief Check every path one frame at a time with the reference logic
+ *
+ * This is the path that mirrors the game the closest, and it is the only
+ * one that can print what every bro chose in verbose mode.
+ *
+ * @param start_frame The first iteration to check
+ * @param end_frame The iteration to stop at
+ * @return void
+ */
+static void Reference_Scan(int64_t start_frame, int64_t end_frame)
+{
+    static struct rng_ring ring;
+
+    RNG_Ring_Init(&ring, Random_Pool, start_frame);
+    for (int64_t i = start_frame; i < end_frame; i++, RNG_Ring_Advance(&ring)) {
+        if (g_verbose) {
+            printf("\n(Iteration %" PRId64 "):\n", i);
+            print_randoms(RNG_Ring_Pool(&ring, i), 9);
+        }
+
+        for (int p = 0; p < Paths.npaths; p++) {
+            int64_t eol;
+
+            if (g_verbose && (p == 0 || Paths.level[p] != Paths.level[p - 1])) {
+                printf("    Checking %s\n", Paths.level_name[Paths.level[p]]);
+            }
+            eol = CheckGoodMovement(&ring, i, p);
+            if (eol) {
+                update_windows(&g_windows, p, eol, RNG_Ring_Pool(&ring, i));
+            }
+        }
+    }
+}
+
+/**
+ * Parallel scans split the frame range into shards. Every shard gets a pool
+ * jumped straight to its first frame and its own scan_windows, and the
+ * shards are merged into g_windows in frame order afterwards, so the output
+ * is the same as a serial scan.
+ */
+#define SHARDS_PER_THREAD   4
+
+struct scan_shard {
+    struct scan_windows ws;
+    char *bits;             // the shard's success bitsets, when they are saved
+    size_t bits_size;
+    uint8_t pool[9];
+    int64_t start_frame;
+    int64_t end_frame;
+};
+
+struct scan_job {
+    struct scan_shard *shards;
+    int nshards;
+    int next;
+};
+
+static void *Shard_Worker(void *arg)
+{
+    struct scan_job *job = arg;
+    int n;
+
+    while ((n = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->nshards) {
+        struct scan_shard *sh = &job->shards[n];
+        Sliced_Scan(&sh->ws, sh->pool, sh->start_frame, sh->end_frame);
+    }
+    return NULL;
+}
+
+struct fort_log {
+    int64_t iteration;
+    int path;
+    const struct window_node *w;
+};
+
+static int fort_log_cmp(const void *a, const void *b)
+{
+    const struct fort_log *x = a, *y = b;
+    if (x->iteration != y->iteration) {
+        return (x->iteration < y->iteration)? -1: 1;
+    }
+    return x->path - y->path;
+}
+
+/**
+ * @brief Log the fort windows of a shard in the order a serial scan would
+ * have logged them as they were added
+ *
+ * @param ws The shard's windows, after its leading run was stitched on
+ * @return void
+ */
+static void Log_Fort_Windows(const struct scan_windows *ws)
+{
+    struct fort_log *logs = NULL;
+    size_t nlogs = 0;
+
+    // Only the text report has them
+    if (g_format != OUTPUT_TEXT) {
+        return;
+    }
+    for (int p = 0; p < Paths.npaths; p++) {
+        const struct window_store *stores[] = { &ws->lead[p], &ws->windows[p] };
+
+        if (!PATH_FORT(p)) {
+            continue;
+        }
+        for (int s = 0; s < ARRAY_SIZE(stores); s++) {
+            for (int i = 0; i < stores[s]->count; i++) {
+                const struct window_node *w = &stores[s]->nodes[i];
+                logs = realloc(logs, (nlogs + 1) * sizeof(*logs));
+                logs[nlogs++] = (struct fort_log) {
+                    // Path_EOLFrame() is iteration plus a per-path constant
+                    .iteration = w->eol_frame - Path_EOLFrame(p, 0),
+                    .path = p,
+                    .w = w,
+                };
+            }
+        }
+    }
+    qsort(logs, nlogs, sizeof(*logs), fort_log_cmp);
+    for (size_t i = 0; i < nlogs; i++) {
+        printf("adding window of length %d for level Level %s: %" PRId64 "\n",
+               logs[i].w->window_length, Paths.name[logs[i].path], logs[i].w->eol_frame);
+    }
+    free(logs);
+}
+
+/**
+ * @brief Merge the windows of a shard into the windows before it
+ *
+ * The shard was scanned without knowing about the frames before it, so the
+ * run of good frames it starts with is stitched onto the window the
+ * previous shards ended with, if there is one.
+ *
+ * @param g The windows of every frame before the shard
+ * @param w The windows of the shard, its windows are added to g
+ * @return void
+ */
+static void Merge_Windows(struct scan_windows *g, struct scan_windows *w)
+{
+    for (int l = 0; l < Paths.npaths; l++) {
+        int stride = PATH_STRIDE(l);
+        int threshold = PATH_MIN_WINDOW(l) - 1;
+        struct window_store *lead = &w->lead[l];
+        int carry;
+        int64_t lead_last;
+
+        if (!w->hits[l]) {
+            continue;
+        }
+
+        carry = (w->lead_eol[l] == g->last_good[l] + stride)? g->windowlen[l]: 0;
+        lead_last = w->lead_eol[l] + (w->lead_len[l] - 1) * stride;
+
+        for (int i = 0; i < lead->count; i++) {
+            lead->nodes[i].window_length += carry;
+        }
+        // Frames of the leading run that are only long enough with the carry
+        for (int i = 1; carry && i <= w->lead_len[l] && i <= threshold; i++) {
+            if (carry + i > threshold) {
+                struct window_node n = {
+                    .window_length = carry + i,
+                    .eol_frame = w->lead_eol[l] + (i - 1) * stride,
+                };
+                memcpy(n.rng, w->lead_rng[l][i - 1], sizeof(n.rng));
+                Store_Add(lead, &n);
+            }
+        }
+
+        if (carry + w->lead_len[l] > g->windowmax[l]) {
+            g->windowmax[l] = carry + w->lead_len[l];
+            g->windowfrm[l] = lead_last;
+        }
+        if (w->rest_max[l] > g->windowmax[l]) {
+            g->windowmax[l] = w->rest_max[l];
+            g->windowfrm[l] = w->rest_frm[l];
+        }
+        g->windowlen[l] = (w->hits[l] == w->lead_len[l])? carry + w->lead_len[l]: w->windowlen[l];
+        g->last_good[l] = w->last_good[l];
+    }
+
+    Log_Fort_Windows(w);
+    // In frame order, so the windows that grow replace their shorter records
+    for (int l = 0; l < Paths.npaths; l++) {
+        qsort(w->lead[l].nodes, w->lead[l].count, sizeof(struct window_node), window_eol_cmp);
+        qsort(w->windows[l].nodes, w->windows[l].count, sizeof(struct window_node), window_eol_cmp);
+        for (int i = 0; i < w->lead[l].count; i++) {
+            Store_Add(&g->windows[l], &w->lead[l].nodes[i]);
+        }
+        for (int i = 0; i < w->windows[l].count; i++) {
+            Store_Add(&g->windows[l], &w->windows[l].nodes[i]);
+        }
+    }
+}
+
+/**
+ * @brief Check every path on g_threads threads
+ *
+ * @param start_frame The first iteration to check
+ * @param end_frame The iteration to stop at
+ * @return void
+ */
+static void Parallel_Scan(int64_t start_frame, int64_t end_frame)
+{
+    struct scan_job job = { 0 };
+    pthread_t *threads;
+    int64_t frames = end_frame - start_frame;
+    int64_t per;
+
+    // Whole blocks per shard, so shards only cost one transpose each
+    per = (frames + g_threads * SHARDS_PER_THREAD - 1) / (g_threads * SHARDS_PER_THREAD);
+    per = (per + SLICE_LANES - 1) / SLICE_LANES * SLICE_LANES;
+    job.nshards = (frames + per - 1) / per;
+    job.shards = calloc(job.nshards, sizeof(struct scan_shard));
+
+    for (int k = 0; k < job.nshards; k++) {
+        struct scan_shard *sh = &job.shards[k];
+        sh->start_frame = start_frame + k * per;
+        sh->end_frame = (end_frame - sh->start_frame > per)? sh->start_frame + per: end_frame;
+        Windows_Init(&sh->ws, true);
+        if (g_windows.bits_out && !(sh->ws.bits_out = open_memstream(&sh->bits, &sh->bits_size))) {
+            fprintf(stderr, "open_memstream: %s\n", strerror(errno));
+            exit(1);
+        }
+        memcpy(sh->pool, Random_Pool, sizeof(sh->pool));
+        Randomize_Pool_N(sh->pool, sh->start_frame - start_frame);
+    }
+
+    threads = calloc(g_threads, sizeof(pthread_t));
+    for (int t = 0; t < g_threads; t++) {
+        if (pthread_create(&threads[t], NULL, Shard_Worker, &job)) {
+            fprintf(stderr, "pthread_create: %s\n", strerror(errno));
+            exit(1);
+        }
+    }
+    for (int t = 0; t < g_threads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    for (int k = 0; k < job.nshards; k++) {
+        struct scan_shard *sh = &job.shards[k];
+
+        Merge_Windows(&g_windows, &sh->ws);
+        if (sh->ws.bits_out) {
+            fclose(sh->ws.bits_out);
+            fwrite(sh->bits, 1, sh->bits_size, g_windows.bits_out);
+            free(sh->bits);
+        }
+        Windows_Free(&sh->ws);
+    }
+
+    free(threads);
+    free(job.shards);
+}
+
+/**
+ * Lag sweep
+ *
+ * Whether a frame is good for a path does not depend on the lag at all,
+ * the lag only shifts which end of level frame a good frame belongs to. So
+ * instead of rebuilding and rescanning for every lag guess, the frames of
+ * every lag are checked once into success bitsets, and each lag of a level
+ * just reads its own range of them: the range that lands on the same end of
+ * level frames the scan covers at the level's own lag.
+ */
+struct lag_range {
+    int lo;
+    int hi;
+};
+
+static char **Sweep_Args;
+static int Sweep_NumArgs;
+
+/**
+ * @brief Parse the -L arguments, `<level>=<lo>:<hi>`, once the paths are known
+ *
+ * @return The lag range of every level, levels without one only use their own lag
+ */
+static struct lag_range *Sweep_Ranges(void)
+{
+    struct lag_range *r = calloc(Paths.nlevels, sizeof(*r));
+
+    for (int l = 0; l < Paths.nlevels; l++) {
+        r[l].lo = r[l].hi = Paths.lag_frames[l];
+    }
+    for (int a = 0; a < Sweep_NumArgs; a++) {
+        char *eq = strchr(Sweep_Args[a], '=');
+        int l, lo, hi;
+
+        if (eq) {
+            *eq = '\0';
+        }
+        if (!eq || (l = Paths_FindLevel(Sweep_Args[a])) < 0 ||
+            sscanf(eq + 1, "%d:%d", &lo, &hi) != 2 || lo < 0 || hi < lo) {
+            fprintf(stderr, "Bad lag range %s%s%s, expected <level>=<lo>:<hi>\n",
+                    Sweep_Args[a], eq? "=": "", eq? eq + 1: "");
+            exit(1);
+        }
+        r[l].lo = lo;
+        r[l].hi = hi;
+    }
+    return r;
+}
+
+/**
+ * @brief Count the windows of a path in a range of a success bitset
+ *
+ * @param bits The bitset
+ * @param a The first bit of the range
+ * @param b The bit the range stops at
+ * @param stride 2 for forts, whose good frames are counted every other frame
+ * @param counts Set to the number of windows of each length, counts[0] unused
+ * @param ncounts The size of counts, grown as needed
+ * @return The longest window
+ */
+static int Sweep_Count(const uint64_t *bits, int a, int b, int stride, int **counts, int *ncounts)
+{
+    struct window_run *runs;
+    int nruns = Bitset_Runs(bits, a, b, stride, &runs);
+    int longest = 0;
+
+    memset(*counts, 0, *ncounts * sizeof(int));
+    for (int i = 0; i < nruns; i++) {
+        if (runs[i].len >= *ncounts) {
+            *counts = realloc(*counts, (runs[i].len + 1) * sizeof(int));
+            memset(*counts + *ncounts, 0, (runs[i].len + 1 - *ncounts) * sizeof(int));
+            *ncounts = runs[i].len + 1;
+        }
+        (*counts)[runs[i].len]++;
+        longest = max(longest, runs[i].len);
+    }
+    free(runs);
+    return longest;
+}
+
+/**
+ * @brief Print the windows of every path for every lag of its level's range
+ *
+ * @param start_frame The first iteration the scan covers at the nominal lags
+ * @param end_frame The iteration the scan stops at at the nominal lags
+ * @return void
+ */
+static void Lag_Sweep(int start_frame, int end_frame)
+{
+    struct lag_range *r = Sweep_Ranges();
+    int lo = start_frame, hi = end_frame;
+    uint8_t pool[9];
+    uint64_t **bits;
+
+    // Lag L covers the iterations that are L - lag_frames earlier
+    for (int l = 0; l < Paths.nlevels; l++) {
+        lo = (lo < start_frame + Paths.lag_frames[l] - r[l].hi)? lo: start_frame + Paths.lag_frames[l] - r[l].hi;
+        hi = max(hi, end_frame + Paths.lag_frames[l] - r[l].lo);
+    }
+    lo = max(lo, 13);
+
+    memcpy(pool, Random_Pool, sizeof(pool));
+    Randomize_Pool_N(pool, lo - 13);
+    bits = Sliced_Bitsets(pool, lo, hi);
+
+    for (int p = 0; p < Paths.npaths; p++) {
+        int l = Paths.level[p];
+        int nlags = r[l].hi - r[l].lo + 1;
+        int **counts = calloc(nlags, sizeof(*counts));
+        int *ncounts = calloc(nlags, sizeof(int));
+        int *longest = calloc(nlags, sizeof(int));
+        int widest = 0;
+
+        for (int k = 0; k < nlags; k++) {
+            int shift = Paths.lag_frames[l] - (r[l].lo + k);
+            int a = max(start_frame + shift, 13);
+            int b = end_frame + shift;
+
+            ncounts[k] = 1;
+            counts[k] = calloc(1, sizeof(int));
+            longest[k] = Sweep_Count(bits[p], a - lo, b - lo, PATH_STRIDE(p), &counts[k], &ncounts[k]);
+            widest = max(widest, longest[k]);
+        }
+
+        printf("Path %s: windows by length for EOL frames %" PRId64 " to %" PRId64 "\n", Paths.name[p],
+               Path_EOLFrame(p, start_frame), Path_EOLFrame(p, end_frame - 1));
+        printf("    lag  max");
+        for (int len = 1; len <= widest; len++) {
+            printf(" %6d", len);
+        }
+        printf("\n");
+        for (int k = 0; k < nlags; k++) {
+            printf("  %5d %4d", r[l].lo + k, longest[k]);
+            for (int len = 1; len <= widest; len++) {
+                printf(" %6d", (len < ncounts[k])? counts[k][len]: 0);
+            }
+            printf("\n");
+            free(counts[k]);
+        }
+        free(counts);
+        free(ncounts);
+        free(longest);
+        free(bits[p]);
+    }
+    free(bits);
+    free(r);
+}
+
+/**
+ * Route optimizer
+ *
+ * The best window of each path on its own is not what the TAS needs: it
+ * needs one window per level of a route, each far enough after the last
+ * one to play the levels in between. For a given shortest window length,
+ * the chain with the fewest frames lost from any first window is found
+ * greedily, taking the earliest window that is far enough after the last,
+ * since taking a later one can only push the rest of the chain back. Each
+ * window is a run of good frames, aimed at by its first end of level frame.
+ */
+struct route_window {
+    int eol;
+    int len;
+};
+
+struct route_chain {
+    int shortest;
+    int lost;
+    int *eol;
+    int *len;
+};
+
+static int route_chain_cmp(const void *a, const void *b)
+{
+    const struct route_chain *x = a, *y = b;
+    if (x->shortest != y->shortest) {
+        return y->shortest - x->shortest;
+    }
+    if (x->lost != y->lost) {
+        return x->lost - y->lost;
+    }
+    return x->eol[0] - y->eol[0];
+}
+
+/**
+ * @brief The first window at or after an end of level frame
+ *
+ * @return Its index, or n if there is none
+ */
+static int Route_LowerBound(const struct route_window *w, int n, int eol)
+{
+    int lo = 0, hi = n;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (w[mid].eol < eol) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * @brief Print the best chains of windows of every route
+ *
+ * @param start_frame The first iteration to check
+ * @param end_frame The iteration to stop at
+ * @param count How many chains to print per route
+ * @return void
+ */
+static void Route_Optimize(int start_frame, int end_frame, int count)
+{
+    struct route_window **windows = calloc(Paths.npaths, sizeof(*windows));
+    int *nwindows = calloc(Paths.npaths, sizeof(int));
+    int *longest = calloc(Paths.npaths, sizeof(int));
+    uint8_t pool[9];
+    uint64_t **bits;
+
+    memcpy(pool, Random_Pool, sizeof(pool));
+    Randomize_Pool_N(pool, start_frame - 13);
+    bits = Sliced_Bitsets(pool, start_frame, end_frame);
+    for (int p = 0; p < Paths.npaths; p++) {
+        struct window_run *runs;
+
+        nwindows[p] = Bitset_Runs(bits[p], 0, end_frame - start_frame, PATH_STRIDE(p), &runs);
+        windows[p] = calloc(nwindows[p] + 1, sizeof(**windows));
+        for (int i = 0; i < nwindows[p]; i++) {
+            windows[p][i].eol = Path_EOLFrame(p, start_frame + runs[i].first);
+            windows[p][i].len = runs[i].len;
+            longest[p] = max(longest[p], runs[i].len);
+        }
+        free(runs);
+        free(bits[p]);
+    }
+    free(bits);
+
+    for (int r = 0; r < Paths.nroutes; r++) {
+        const int *path = &Paths.step_path[Paths.route_first[r]];
+        const int *gap = &Paths.step_gap[Paths.route_first[r]];
+        int nsteps = Paths.route_count[r];
+        struct route_window **w = calloc(nsteps, sizeof(*w));
+        int *nw = calloc(nsteps, sizeof(int));
+        struct route_chain *chains = NULL;
+        int nchains = 0, gaps = 0, top = INT32_MAX;
+
+        for (int k = 0; k < nsteps; k++) {
+            w[k] = calloc(nwindows[path[k]] + 1, sizeof(**w));
+            top = (top < longest[path[k]])? top: longest[path[k]];
+            gaps += gap[k];
+        }
+
+        // Shortest window lengths from the best down, until there are enough chains
+        for (int t = top; t > 0 && nchains < count; t--) {
+            for (int k = 0; k < nsteps; k++) {
+                nw[k] = 0;
+                for (int i = 0; i < nwindows[path[k]]; i++) {
+                    if (windows[path[k]][i].len >= t) {
+                        w[k][nw[k]++] = windows[path[k]][i];
+                    }
+                }
+            }
+            for (int i = 0; i < nw[0]; i++) {
+                struct route_chain c = {
+                    .shortest = w[0][i].len,
+                    .eol = malloc(nsteps * sizeof(int)),
+                    .len = malloc(nsteps * sizeof(int)),
+                };
+                int k;
+
+                c.eol[0] = w[0][i].eol;
+                c.len[0] = w[0][i].len;
+                for (k = 1; k < nsteps; k++) {
+                    int j = Route_LowerBound(w[k], nw[k], c.eol[k - 1] + gap[k]);
+                    if (j == nw[k]) {
+                        break;
+                    }
+                    c.eol[k] = w[k][j].eol;
+                    c.len[k] = w[k][j].len;
+                    c.shortest = (c.shortest < c.len[k])? c.shortest: c.len[k];
+                }
+                // Chains with longer windows throughout were found already
+                if (k < nsteps || c.shortest != t) {
+                    free(c.eol);
+                    free(c.len);
+                    continue;
+                }
+                c.lost = c.eol[nsteps - 1] - c.eol[0] - gaps;
+                chains = realloc(chains, (nchains + 1) * sizeof(*chains));
+                chains[nchains++] = c;
+            }
+        }
+        qsort(chains, nchains, sizeof(*chains), route_chain_cmp);
+
+        printf("Route %s:", Paths.route_name[r]);
+        for (int k = 0; k < nsteps; k++) {
+            if (k > 0) {
+                printf(" +%d", gap[k]);
+            }
+            printf(" %s", Paths.name[path[k]]);
+        }
+        printf("\n  shortest   lost");
+        for (int k = 0; k < nsteps; k++) {
+            printf((k < nsteps - 1)? "  %-12s": "  %s", Paths.name[path[k]]);
+        }
+        printf("\n");
+        for (int i = 0; i < nchains; i++) {
+            if (i < count) {
+                printf("  %8d %6d", chains[i].shortest, chains[i].lost);
+                for (int k = 0; k < nsteps; k++) {
+                    printf((k < nsteps - 1)? "  %6d x%-4d": "  %6d x%d", chains[i].eol[k], chains[i].len[k]);
+                }
+                printf("\n");
+            }
+            free(chains[i].eol);
+            free(chains[i].len);
+        }
+        free(chains);
+        for (int k = 0; k < nsteps; k++) {
+            free(w[k]);
+        }
+        free(w);
+        free(nw);
+    }
+
+    for (int p = 0; p < Paths.npaths; p++) {
+        free(windows[p]);
+    }
+    free(windows);
+    free(nwindows);
+    free(longest);
+}
+
+/**
+ * Inverse RNG index
+ *
+ * The RNG bit stream repeats every RNG_PERIOD ticks, so every Random_Pool
+ * the game can have is one of a few tens of thousands. The index maps a hash
+ * of the pool of every stride-th iteration, starting at the first, to that
+ * iteration in an open-addressed hash table that is written to disk as is
+ * and mmapped to be used. A pool that is not indexed is ticked forward until
+ * it is, at most stride - 1 times, and every hit is checked by jumping the
+ * initial pool to it, so hash collisions can't give a wrong answer.
+ *
+ * The file is in the byte order of the machine that wrote it.
+ */
+#define RNG_PERIOD          32767
+#define RNG_INDEX_MAGIC     "SMB3RNGI"
+#define RNG_INDEX_VERSION   1
+
+struct rng_index_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t stride;            // every stride-th iteration is indexed
+    uint32_t first;             // the first indexed iteration
+    uint32_t last;              // the last indexed iteration
+    uint32_t nslots;            // a power of 2
+    uint8_t pool[9];            // the Random_Pool the iterations start from
+    uint8_t pad[3];
+};
+
+struct rng_index_slot {
+    uint64_t hash;
+    uint32_t iteration;         // 0 for an empty slot
+    uint32_t reserved;
+};
+
+struct rng_index {
+    void *map;
+    size_t size;
+    const struct rng_index_header *hdr;
+    const struct rng_index_slot *slots;
+    // For an index built in memory, the pool of every iteration from first
+    uint8_t (*pools)[9];
+};
+
+static struct rng_index g_index;
+
+// The windows a query prints per path
+#define RNG_INDEX_WINDOWS   3
+
+static inline uint64_t RNG_Hash(const uint8_t *pool)
+{
+    uint64_t h;
+
+    memcpy(&h, pool, sizeof(h));
+    h ^= (uint64_t)pool[8] * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+/**
+ * @brief Build an index of every stride-th iteration of the RNG in memory
+ *
+ * Iterations are indexed from 13, where the RNG starts ticking, through a
+ * whole period after the ticks it takes for the initial pool to be shifted
+ * out, plus a stride, so any pool reaches an indexed one going forward.
+ *
+ * @param ix The index
+ * @param stride Index every stride-th iteration
+ * @param keep_pools Also keep the pool of every iteration, to look pools up
+ *        without jumping the RNG
+ * @return void
+ */
+static void RNG_Index_Make(struct rng_index *ix, int stride, bool keep_pools)
+{
+    int count = (RNG_BITS + RNG_PERIOD + stride) / stride + 1;
+    struct rng_index_header *hdr;
+    struct rng_index_slot *slots;
+    uint32_t nslots = 1;
+    uint8_t pool[9];
+
+    // At most half full
+    while (nslots < 2 * count) {
+        nslots <<= 1;
+    }
+    ix->size = sizeof(*hdr) + nslots * sizeof(*slots);
+    ix->map = calloc(1, ix->size);
+    ix->hdr = hdr = ix->map;
+    ix->slots = slots = (struct rng_index_slot *)(hdr + 1);
+    ix->pools = keep_pools? calloc((count - 1) * stride + 1, sizeof(*ix->pools)): NULL;
+    *hdr = (struct rng_index_header) {
+        .magic = RNG_INDEX_MAGIC,
+        .version = RNG_INDEX_VERSION,
+        .stride = stride,
+        .first = 13,
+        .last = 13 + (count - 1) * stride,
+        .nslots = nslots,
+    };
+    memcpy(hdr->pool, Random_Pool, sizeof(hdr->pool));
+    memcpy(pool, Random_Pool, sizeof(pool));
+    Randomize_Pool(pool);
+
+    for (uint32_t i = hdr->first; i <= hdr->last; i++, Randomize_Pool(pool)) {
+        uint64_t h = RNG_Hash(pool);
+        uint32_t s = h & (nslots - 1);
+
+        if (ix->pools) {
+            memcpy(ix->pools[i - hdr->first], pool, sizeof(pool));
+        }
+        if ((i - hdr->first) % stride) {
+            continue;
+        }
+        // Pools that come around again keep their first iteration
+        while (slots[s].iteration && slots[s].hash != h) {
+            s = (s + 1) & (nslots - 1);
+        }
+        if (!slots[s].iteration) {
+            slots[s] = (struct rng_index_slot) { .hash = h, .iteration = i };
+        }
+    }
+}
+
+/**
+ * @brief Write an index of every stride-th iteration of the RNG
+ *
+ * @param file The index file
+ * @param stride Index every stride-th iteration
+ * @return void
+ */
+static void RNG_Index_Build(const char *file, int stride)
+{
+    struct rng_index ix;
+    FILE *f;
+
+    RNG_Index_Make(&ix, stride, false);
+    if (!(f = fopen(file, "wb")) || fwrite(ix.map, ix.size, 1, f) != 1 || fclose(f)) {
+        fprintf(stderr, "Could not write %s: %s\n", file, strerror(errno));
+        exit(1);
+    }
+    free(ix.map);
+}
+
+/**
+ * @brief Check whether an iteration's Random_Pool is pool
+ */
+static bool RNG_Index_Check(const struct rng_index *ix, int iteration, const uint8_t *pool)
+{
+    uint8_t check[9];
+
+    if (iteration < (int)ix->hdr->first) {
+        return false;
+    }
+    if (ix->pools && iteration <= (int)ix->hdr->last) {
+        return !memcmp(ix->pools[iteration - ix->hdr->first], pool, sizeof(check));
+    }
+    memcpy(check, ix->hdr->pool, sizeof(check));
+    Randomize_Pool_N(check, iteration - ix->hdr->first + 1);
+    return !memcmp(check, pool, sizeof(check));
+}
+
+/**
+ * @brief Map an index written by RNG_Index_Build()
+ *
+ * @param ix The index
+ * @param file The index file
+ * @return 0 on success, -1 with errno set otherwise
+ */
+static int RNG_Index_Open(struct rng_index *ix, const char *file)
+{
+    struct stat st;
+    int fd = open(file, O_RDONLY);
+
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+    ix->size = st.st_size;
+    ix->map = mmap(NULL, ix->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ix->map == MAP_FAILED) {
+        return -1;
+    }
+    ix->hdr = ix->map;
+    ix->slots = (const struct rng_index_slot *)(ix->hdr + 1);
+    ix->pools = NULL;
+    if (ix->size < sizeof(*ix->hdr) || memcmp(ix->hdr->magic, RNG_INDEX_MAGIC, 8) ||
+        ix->hdr->version != RNG_INDEX_VERSION ||
+        ix->size != sizeof(*ix->hdr) + (size_t)ix->hdr->nslots * sizeof(*ix->slots)) {
+        munmap(ix->map, ix->size);
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Find the first iteration whose Random_Pool is pool
+ *
+ * The same pool comes around again every RNG_PERIOD iterations.
+ *
+ * @param ix The index
+ * @param pool The Random_Pool to look up
+ * @return The iteration, or -1 if the RNG never gets to pool
+ */
+static int RNG_Index_Lookup(const struct rng_index *ix, const uint8_t *pool)
+{
+    const struct rng_index_header *hdr = ix->hdr;
+    uint8_t p[9];
+
+    if (ix->pools && hdr->stride == 1) {
+        // Every pool is indexed, no need to walk
+        uint64_t h = RNG_Hash(pool);
+        for (uint32_t s = h & (hdr->nslots - 1); ix->slots[s].iteration; s = (s + 1) & (hdr->nslots - 1)) {
+            if (ix->slots[s].hash == h && RNG_Index_Check(ix, ix->slots[s].iteration, pool)) {
+                return ix->slots[s].iteration;
+            }
+        }
+        return -1;
+    }
+
+    memcpy(p, pool, sizeof(p));
+    for (int t = 0; t < 2 * hdr->stride; t++, Randomize_Pool(p)) {
+        uint64_t h = RNG_Hash(p);
+        uint32_t s = h & (hdr->nslots - 1);
+
+        for (; ix->slots[s].iteration; s = (s + 1) & (hdr->nslots - 1)) {
+            int i = ix->slots[s].iteration - t;
+
+            if (ix->slots[s].hash != h) {
+                continue;
+            }
+            if (i < (int)hdr->first) {
+                i += RNG_PERIOD;
+            }
+            if (!RNG_Index_Check(ix, i, pool)) {
+                continue;
+            }
+            // The walk can reach an indexed pool of the next time around first
+            if (RNG_Index_Check(ix, i - RNG_PERIOD, pool)) {
+                i -= RNG_PERIOD;
+            }
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Parse the 9 bytes of a Random_Pool in hex, spaces are optional
+ *
+ * @return true if there were exactly 9 bytes
+ */
+static bool Parse_Pool(const char *hex, uint8_t *pool)
+{
+    int n = 0;
+
+    for (const char *c = hex; *c; c++) {
+        int v;
+        if (*c == ' ' || *c == ':') {
+            continue;
+        }
+        if (n == 18 || sscanf((char[]){ c[0], '\0' }, "%x", &v) != 1) {
+            return false;
+        }
+        pool[n / 2] = (n % 2)? pool[n / 2] | v: v << 4;
+        n++;
+    }
+    return n == 18;
+}
+
+/**
+ * @brief Print the frame of a Random_Pool and the next windows of every path
+ *
+ * @param hex The 9 bytes of Random_Pool in hex, spaces are optional
+ * @param count How many windows to print per path
+ * @return 0 if the pool was found, 1 otherwise
+ */
+static int RNG_Index_Query(const char *hex, int count)
+{
+    uint8_t pool[9], before[9];
+    uint64_t **bits;
+    int iteration;
+
+    if (!Parse_Pool(hex, pool)) {
+        fprintf(stderr, "Expected 9 bytes of Random_Pool in hex, got %s\n", hex);
+        exit(1);
+    }
+
+    iteration = RNG_Index_Lookup(&g_index, pool);
+    printf("Random_Pool ");
+    print_randoms(pool, sizeof(pool));
+    if (iteration < 0) {
+        printf("is never reached from ");
+        print_randoms(g_index.hdr->pool, sizeof(g_index.hdr->pool));
+        return 1;
+    }
+    printf("is iteration %d, and every %d iterations after it\n", iteration, RNG_PERIOD);
+
+    // Scan the next period from the iteration on
+    memcpy(before, g_index.hdr->pool, sizeof(before));
+    Randomize_Pool_N(before, iteration - 13);
+    bits = Sliced_Bitsets(before, iteration, iteration + RNG_PERIOD);
+    for (int p = 0; p < Paths.npaths; p++) {
+        struct window_run *runs;
+        int nruns = Bitset_Runs(bits[p], 0, RNG_PERIOD, PATH_STRIDE(p), &runs);
+        int shown = 0;
+
+        printf("Level %s:\n", Paths.name[p]);
+        for (int i = 0; i < nruns && shown < count; i++) {
+            // The same windows as the report, from 2 frames for forts and 3 for levels,
+            // which lists them by their last frame
+            if (runs[i].len >= PATH_MIN_WINDOW(p)) {
+                int64_t eol = Path_EOLFrame(p, iteration + runs[i].first);
+
+                printf("    EOL: %" PRId64 "-%" PRId64 ", %d-frame window\n",
+                       eol, eol + (int64_t)(runs[i].len - 1) * PATH_STRIDE(p), runs[i].len);
+                shown++;
+            }
+        }
+        free(runs);
+        free(bits[p]);
+    }
+    free(bits);
+    return 0;
+}
+
+/**
+ * Checkpoints
+ *
+ * With -C file, a window scan saves everything it carries from one frame to
+ * the next, the pool and g_windows, every CHECKPOINT_SECONDS and when it
+ * gets SIGINT or SIGTERM. Running the same command again resumes from the
+ * checkpoint, and the checkpoint is removed once the report is printed.
+ *
+ * The checkpoint also keeps how long stdout was when it was saved. When
+ * the resumed run appends to the same file, with >>, whatever was printed
+ * after the checkpoint is cut off first, so the file ends up the same as
+ * an uninterrupted run's. The -B file is cut back the same way.
+ */
+#define CHECKPOINT_MAGIC    "SMB3RNGC"
+#define CHECKPOINT_VERSION  3
+#define CHECKPOINT_SECONDS  60
+#define CHECKPOINT_FRAMES   (1 << 20)   // frames scanned between looks at the clock
+
+struct checkpoint_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t npaths;
+    uint64_t spec_hash;         // see Paths_Hash()
+    int64_t start_frame;
+    int64_t end_frame;
+    int64_t next_frame;         // the first iteration left to check
+    int64_t out_size;           // the size of stdout, -1 if it is not a file
+    int64_t bits_size;          // the size of the -B file, -1 without one
+    int32_t top_windows;
+    int32_t verbose;
+    int32_t stride;
+    int32_t min_window;
+    int32_t format;
+    uint8_t pool[9];            // the Random_Pool one tick before next_frame
+};
+
+static const char *Checkpoint_File;
+static const char *Bitset_File;     // -B, see Bitsets_Open()
+static volatile sig_atomic_t Scan_Stop;
+
+static void Scan_Signal(int sig)
+{
+    Scan_Stop = sig;
+}
+
+/**
+ * @brief Hash the paths, so a checkpoint is only resumed with the same spec
+ *
+ * @return The FNV-1a hash of the paths as Paths_Print() prints them
+ */
+static uint64_t Paths_Hash(void)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    char *buf;
+    size_t len;
+    FILE *f = open_memstream(&buf, &len);
+
+    if (!f) {
+        fprintf(stderr, "open_memstream: %s\n", strerror(errno));
+        exit(1);
+    }
+    Paths_Print(f);
+    fclose(f);
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)buf[i]) * 0x100000001b3ULL;
+    }
+    free(buf);
+    return hash;
+}
+
+/**
+ * @brief Save the state of a scan to Checkpoint_File
+ *
+ * The checkpoint is written next to the file and renamed over it, so the
+ * last one survives a crash while saving.
+ *
+ * @param start_frame The first iteration of the scan
+ * @param end_frame The iteration the scan stops at
+ * @param next_frame The first iteration left to check
+ * @return void
+ */
+static void Checkpoint_Save(int64_t start_frame, int64_t end_frame, int64_t next_frame)
+{
+    struct checkpoint_header h = {
+        .magic = CHECKPOINT_MAGIC,
+        .version = CHECKPOINT_VERSION,
+        .npaths = Paths.npaths,
+        .spec_hash = Paths_Hash(),
+        .start_frame = start_frame,
+        .end_frame = end_frame,
+        .next_frame = next_frame,
+        .bits_size = -1,
+        .top_windows = g_top_windows,
+        .verbose = g_verbose,
+        .stride = g_stride,
+        .min_window = g_min_window,
+        .format = g_format,
+    };
+    char tmp[strlen(Checkpoint_File) + 5];
+    struct stat st;
+    bool ok;
+    FILE *f;
+
+    fflush(stdout);
+    h.out_size = (!fstat(STDOUT_FILENO, &st) && S_ISREG(st.st_mode))? st.st_size: -1;
+    if (g_windows.bits_out) {
+        fflush(g_windows.bits_out);
+        h.bits_size = ftello(g_windows.bits_out);
+    }
+    memcpy(h.pool, Random_Pool, sizeof(h.pool));
+
+    sprintf(tmp, "%s.tmp", Checkpoint_File);
+    ok = (f = fopen(tmp, "wb")) && fwrite(&h, sizeof(h), 1, f) == 1;
+    for (int p = 0; ok && p < Paths.npaths; p++) {
+        const struct window_store *st = &g_windows.windows[p];
+
+        ok = fwrite(&g_windows.last_good[p], sizeof(int64_t), 1, f) == 1 &&
+             fwrite(&g_windows.windowlen[p], sizeof(int), 1, f) == 1 &&
+             fwrite(&g_windows.windowmax[p], sizeof(int), 1, f) == 1 &&
+             fwrite(&g_windows.windowfrm[p], sizeof(int64_t), 1, f) == 1 &&
+             fwrite(&st->count, sizeof(int), 1, f) == 1 &&
+             fwrite(st->nodes, sizeof(*st->nodes), st->count, f) == st->count;
+    }
+    if (f && fclose(f)) {
+        ok = false;
+    }
+    if (!ok || rename(tmp, Checkpoint_File)) {
+        fprintf(stderr, "Could not write %s: %s\n", Checkpoint_File, strerror(errno));
+        exit(1);
+    }
+}
+
+/**
+ * @brief Restore the state of a scan from Checkpoint_File, if there is one
+ *
+ * @param start_frame The first iteration of the scan
+ * @param end_frame The iteration the scan stops at
+ * @param next_frame Set to the first iteration left to check
+ * @param bits_size Set to the size of the -B file, -1 without one
+ * @return true if the scan was restored, false if there is no checkpoint
+ */
+static bool Checkpoint_Load(int64_t start_frame, int64_t end_frame, int64_t *next_frame, int64_t *bits_size)
+{
+    struct checkpoint_header h;
+    struct stat st;
+    bool ok;
+    FILE *f;
+
+    if (!(f = fopen(Checkpoint_File, "rb"))) {
+        if (errno == ENOENT) {
+            return false;
+        }
+        fprintf(stderr, "Could not open %s: %s\n", Checkpoint_File, strerror(errno));
+        exit(1);
+    }
+    if (fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) ||
+        h.version != CHECKPOINT_VERSION) {
+        fprintf(stderr, "%s is not a checkpoint\n", Checkpoint_File);
+        exit(1);
+    }
+    if (h.npaths != Paths.npaths || h.spec_hash != Paths_Hash() || h.start_frame != start_frame ||
+        h.end_frame != end_frame || h.top_windows != g_top_windows || h.verbose != g_verbose ||
+        h.stride != g_stride || h.min_window != g_min_window || h.format != g_format) {
+        fprintf(stderr, "%s is a checkpoint of another scan, of iterations %" PRId64 " to %" PRId64 "\n",
+                Checkpoint_File, h.start_frame, h.end_frame);
+        exit(1);
+    }
+    if ((h.bits_size >= 0) != (Bitset_File != NULL)) {
+        fprintf(stderr, "%s is a checkpoint of a scan %s -B, resume it the same way\n",
+                Checkpoint_File, (h.bits_size >= 0)? "with": "without");
+        exit(1);
+    }
+
+    ok = true;
+    for (int p = 0; ok && p < Paths.npaths; p++) {
+        struct window_store *store = &g_windows.windows[p];
+        int count;
+
+        ok = fread(&g_windows.last_good[p], sizeof(int64_t), 1, f) == 1 &&
+             fread(&g_windows.windowlen[p], sizeof(int), 1, f) == 1 &&
+             fread(&g_windows.windowmax[p], sizeof(int), 1, f) == 1 &&
+             fread(&g_windows.windowfrm[p], sizeof(int64_t), 1, f) == 1 &&
+             fread(&count, sizeof(int), 1, f) == 1;
+        for (int i = 0; ok && i < count; i++) {
+            struct window_node w;
+
+            ok = fread(&w, sizeof(w), 1, f) == 1;
+            Store_Add(store, &w);
+        }
+        // The window the scan stopped in grows on from its record
+        store->last = -1;
+        for (int i = 0; store->limit && i < store->count; i++) {
+            if (Store_Key(store, &store->nodes[i]) ==
+                g_windows.last_good[p] - (int64_t)(g_windows.windowlen[p] - 1) * store->stride) {
+                store->last = i;
+            }
+        }
+    }
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "%s is truncated\n", Checkpoint_File);
+        exit(1);
+    }
+
+    // Drop whatever was printed after the checkpoint
+    fflush(stdout);
+    if (h.out_size >= 0 && !fstat(STDOUT_FILENO, &st) && S_ISREG(st.st_mode) &&
+        st.st_size > h.out_size && ftruncate(STDOUT_FILENO, h.out_size)) {
+        fprintf(stderr, "Could not truncate stdout: %s\n", strerror(errno));
+        exit(1);
+    }
+
+    memcpy(Random_Pool, h.pool, sizeof(Random_Pool));
+    *next_frame = h.next_frame;
+    *bits_size = h.bits_size;
+    fprintf(stderr, "Resuming from %s at iteration %" PRId64 "\n", Checkpoint_File, h.next_frame);
+    return true;
+}
+
+/**
+ * Bitset files
+ *
+ * With -B file, a window scan also saves its success bitsets, and -A file
+ * finds the windows in them again, with other -m, -t and -k settings,
+ * without checking any path. The file is a header and then the chunks
+ * Bitsets_Write() appends, in frame order.
+ */
+#define BITSET_MAGIC    "SMB3RNGB"
+#define BITSET_VERSION  1
+
+struct bitset_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t npaths;
+    uint64_t spec_hash;         // see Paths_Hash()
+    int64_t start_frame;
+    int64_t end_frame;
+    uint8_t pool[9];            // the Random_Pool one tick before start_frame
+};
+
+/**
+ * @brief Open Bitset_File for the scan to save its bitsets to g_windows.bits_out
+ *
+ * @param start_frame The first iteration of the scan, Random_Pool is the
+ *        pool one tick before it unless the scan was resumed
+ * @param end_frame The iteration the scan stops at
+ * @param resume_size The size of the file at the checkpoint the scan was
+ *        resumed from, or -1 to start a new file
+ * @return void
+ */
+static void Bitsets_Open(int64_t start_frame, int64_t end_frame, int64_t resume_size)
+{
+    struct bitset_header h = {
+        .magic = BITSET_MAGIC,
+        .version = BITSET_VERSION,
+        .npaths = Paths.npaths,
+        .spec_hash = Paths_Hash(),
+        .start_frame = start_frame,
+        .end_frame = end_frame,
+    };
+    FILE *f;
+
+    if (resume_size >= 0) {
+        if (!(f = fopen(Bitset_File, "r+b")) || ftruncate(fileno(f), resume_size) ||
+            fseeko(f, resume_size, SEEK_SET)) {
+            fprintf(stderr, "Could not resume %s: %s\n", Bitset_File, strerror(errno));
+            exit(1);
+        }
+    } else {
+        memcpy(h.pool, Random_Pool, sizeof(h.pool));
+        if (!(f = fopen(Bitset_File, "wb")) || fwrite(&h, sizeof(h), 1, f) != 1) {
+            fprintf(stderr, "Could not write %s: %s\n", Bitset_File, strerror(errno));
+            exit(1);
+        }
+    }
+    g_windows.bits_out = f;
+}
+
+static void Bitsets_Close(void)
+{
+    if (g_windows.bits_out && (ferror(g_windows.bits_out) | fclose(g_windows.bits_out))) {
+        fprintf(stderr, "Could not write %s\n", Bitset_File);
+        exit(1);
+    }
+    g_windows.bits_out = NULL;
+}
+
+/**
+ * Output
+ *
+ * Everything goes to stdout through its stdio buffer, which is made
+ * OUTPUT_BUFFER_SIZE when stdout is not a terminal, and nothing flushes it
+ * but a checkpoint and the end of the report. The report's windows are
+ * records of their path, end of level frame, length and init rng, and -o
+ * picks how they are written:
+ *
+ *   text       the report as it has always been printed
+ *   csv        a path,eol,len,rng line, then one line per window
+ *   jsonl      {"path":"2-1__1","eol":16610,"len":3,"rng":"b382e5e02bebbc6b13"}
+ *              per window
+ *   binary     a window_file_header and the NUL-terminated name of every
+ *              path, then a window_record per window, in the byte order of
+ *              the machine that wrote them
+ *
+ * Records are in the report's order, by path, then length, then frame. The
+ * other formats only have the records: the text around them and the fort
+ * windows a scan logs as it finds them are left out.
+ */
+#define OUTPUT_BUFFER_SIZE  (1 << 20)
+#define WINDOW_FILE_MAGIC   "SMB3RNGW"
+#define WINDOW_FILE_VERSION 1
+
+struct window_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t npaths;
+};
+
+struct window_record {
+    int64_t eol;
+    int32_t path;               // the index of its name
+    int32_t len;
+    uint8_t rng[9];
+    uint8_t pad[7];
+};
+
+/**
+ * @brief Parse the argument of -o
+ *
+ * @return true if it names a format
+ */
+static bool Output_Parse(const char *arg, enum output_format *format)
+{
+    static const char *const names[] = {
+        [OUTPUT_TEXT] = "text",
+        [OUTPUT_CSV] = "csv",
+        [OUTPUT_JSONL] = "jsonl",
+        [OUTPUT_BINARY] = "binary",
+    };
+
+    for (int f = 0; f < ARRAY_SIZE(names); f++) {
+        if (!strcmp(arg, names[f])) {
+            *format = f;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Write a path's name as a CSV field or a JSON string
+ */
+static void Output_Name(const char *name)
+{
+    if (g_format == OUTPUT_JSONL) {
+        putchar('"');
+        for (const char *c = name; *c; c++) {
+            if (*c == '"' || *c == '\\') {
+                putchar('\\');
+                putchar(*c);
+            } else if ((uint8_t)*c < 0x20) {
+                printf("\\u%04x", *c);
+            } else {
+                putchar(*c);
+            }
+        }
+        putchar('"');
+    } else if (strpbrk(name, ",\"\r\n")) {
+        putchar('"');
+        for (const char *c = name; *c; c++) {
+            if (*c == '"') {
+                putchar('"');
+            }
+            putchar(*c);
+        }
+        putchar('"');
+    } else {
+        fputs(name, stdout);
+    }
+}
+
+/**
+ * @brief Write what comes before the records of a format that isn't text
+ *
+ * @return void
+ */
+static void Output_Begin(void)
+{
+    struct window_file_header h = {
+        .magic = WINDOW_FILE_MAGIC,
+        .version = WINDOW_FILE_VERSION,
+        .npaths = Paths.npaths,
+    };
+
+    if (g_format == OUTPUT_CSV) {
+        fputs("path,eol,len,rng\n", stdout);
+    } else if (g_format == OUTPUT_BINARY) {
+        fwrite(&h, sizeof(h), 1, stdout);
+        for (int p = 0; p < Paths.npaths; p++) {
+            fwrite(Paths.name[p], 1, strlen(Paths.name[p]) + 1, stdout);
+        }
+    }
+}
+
+/**
+ * @brief Write the record of a window in a format that isn't text
+ *
+ * @param p The path
+ * @param w The window
+ * @return void
+ */
+static void Output_Window(int p, const struct window_node *w)
+{
+    struct window_record r = {
+        .eol = w->eol_frame,
+        .path = p,
+        .len = w->window_length,
+    };
+    char rng[2 * sizeof(w->rng) + 1];
+
+    if (g_format == OUTPUT_BINARY) {
+        memcpy(r.rng, w->rng, sizeof(r.rng));
+        fwrite(&r, sizeof(r), 1, stdout);
+        return;
+    }
+    *Hex_Bytes(rng, w->rng, sizeof(w->rng), '\0') = '\0';
+    if (g_format == OUTPUT_JSONL) {
+        fputs("{\"path\":", stdout);
+        Output_Name(Paths.name[p]);
+        printf(",\"eol\":%" PRId64 ",\"len\":%d,\"rng\":\"%s\"}\n", w->eol_frame, w->window_length, rng);
+    } else {
+        Output_Name(Paths.name[p]);
+        printf(",%" PRId64 ",%d,%s\n", w->eol_frame, w->window_length, rng);
+    }
+}
+
+/**
+ * @brief Make sure everything written so far got out
+ *
+ * @return void
+ */
+static void Output_End(void)
+{
+    if (fflush(stdout)) {
+        fprintf(stderr, "Could not write the report: %s\n", strerror(errno));
+        exit(1);
+    }
+}
+
+/**
+ * @brief Write the records of every path's windows in a format that isn't text
+ *
+ * @return void
+ */
+static void Output_Records(void)
+{
+    Output_Begin();
+    for (int p = 0; p < Paths.npaths; p++) {
+        struct window_store *st = &g_windows.windows[p];
+
+        Store_Sort(st);
+        for (int k = 0; k < st->count; k++) {
+            Output_Window(p, &st->nodes[k]);
+        }
+    }
+    Output_End();
+}
+
+/**
+ * @brief Print the windows of every path
+ *
+ * @return void
+ */
+static void Windows_Report(void)
+{
+    if (g_format != OUTPUT_TEXT) {
+        Output_Records();
+        return;
+    }
+    for (int p = 0; p < Paths.npaths; p++) {
+        printf("Max window for %s: %d\n", Paths.name[p], g_windows.windowmax[p]);
+    }
+    for (int i = 0; i < Paths.npaths; i++) {
+        printf("Level %s:\n", Paths.name[i]);
+        struct window_store *st = &g_windows.windows[i];
+        int k = 0;
+
+        Store_Sort(st);
+        for (int len = min(2, PATH_MIN_WINDOW(i)); len <= g_windows.windowmax[i]; len++) {
+            printf("  %d-frame windows:\n", len);
+            for (; k < st->count && st->nodes[k].window_length == len; k++) {
+                printf("    EOL: %" PRId64 "\n        init rng ", st->nodes[k].eol_frame);
+                print_randoms(st->nodes[k].rng, sizeof(st->nodes[k].rng));
+            }
+        }
+    }
+    Output_End();
+}
+
+/**
+ * @brief Find the windows in a file of success bitsets and print them like
+ * a scan of the same frames would
+ *
+ * @param file The file, saved by -B
+ * @return 0
+ */
+static int Bitsets_Analyze(const char *file)
+{
+    struct bitset_header h;
+    uint64_t *bits[Paths.npaths];
+    uint8_t *buf = malloc(3 * SCAN_CHUNK_FRAMES + 16);
+    int64_t first, next;
+    int32_t frames;
+    FILE *f;
+
+    if (!(f = fopen(file, "rb"))) {
+        fprintf(stderr, "Could not open %s: %s\n", file, strerror(errno));
+        exit(1);
+    }
+    if (fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, BITSET_MAGIC, sizeof(h.magic)) ||
+        h.version != BITSET_VERSION) {
+        fprintf(stderr, "%s is not a bitset file\n", file);
+        exit(1);
+    }
+    if (h.npaths != Paths.npaths || h.spec_hash != Paths_Hash()) {
+        fprintf(stderr, "%s holds the bitsets of other paths\n", file);
+        exit(1);
+    }
+    for (int p = 0; p < Paths.npaths; p++) {
+        bits[p] = malloc(Bitset_Words(SCAN_CHUNK_FRAMES) * sizeof(uint64_t));
+    }
+
+    if (g_format == OUTPUT_TEXT) {
+        print_randoms(Random_Pool, sizeof(Random_Pool));
+    }
+    memcpy(Random_Pool, h.pool, sizeof(Random_Pool));
+    for (next = h.start_frame; fread(&first, sizeof(first), 1, f) == 1; next += frames) {
+        if (fread(&frames, sizeof(frames), 1, f) != 1 || first != next ||
+            frames < 1 || frames > SCAN_CHUNK_FRAMES) {
+            break;
+        }
+        for (int p = 0; p < Paths.npaths; p++) {
+            uint32_t len, at = 0;
+            int i = 0;
+
+            memset(bits[p], 0, Bitset_Words(SCAN_CHUNK_FRAMES) * sizeof(uint64_t));
+            if (fread(&len, sizeof(len), 1, f) != 1 || len > 3 * SCAN_CHUNK_FRAMES ||
+                fread(buf, 1, len, f) != len) {
+                fprintf(stderr, "%s is truncated\n", file);
+                exit(1);
+            }
+            while (at < len) {
+                uint32_t gap = 0;
+
+                for (int sh = 0; at < len; sh += 7) {
+                    gap |= (uint32_t)(buf[at] & 0x7f) << sh;
+                    if (!(buf[at++] & 0x80)) {
+                        break;
+                    }
+                }
+                i += gap;
+                if (i >= frames) {
+                    fprintf(stderr, "%s is corrupt\n", file);
+                    exit(1);
+                }
+                bits[p][i / 64] |= 1ULL << (i % 64);
+                i++;
+            }
+        }
+        Windows_AddBitsets(&g_windows, bits, first, frames, Random_Pool);
+    }
+    if (next != h.end_frame) {
+        fprintf(stderr, "%s stops at iteration %" PRId64 " of %" PRId64 "\n", file, next, h.end_frame);
+        exit(1);
+    }
+    fclose(f);
+
+    Windows_Report();
+    for (int p = 0; p < Paths.npaths; p++) {
+        free(bits[p]);
+    }
+    free(buf);
+    return 0;
+}
+
+/**
+ * @brief Scan a range of iterations with the engine the options ask for
+ *
+ * @param start_frame The first iteration to check, Random_Pool is the pool
+ *        one tick before it
+ * @param end_frame The iteration to stop at
+ * @return void
+ */
+static void Scan_Range(int64_t start_frame, int64_t end_frame)
+{
+    uint8_t pool[9];
+
+    if (g_verbose) {
+        Reference_Scan(start_frame, end_frame);
+    } else if (g_threads > 1 && start_frame < end_frame) {
+        Parallel_Scan(start_frame, end_frame);
+    } else {
+        memcpy(pool, Random_Pool, sizeof(pool));
+        Sliced_Scan(&g_windows, pool, start_frame, end_frame);
+    }
+}
+
+static int do_early_hammer(int64_t start_frame, int64_t end_frame)
+{
+    int64_t frame = start_frame;
+    int64_t bits_size = -1;
+    time_t saved = time(NULL);
+
+    /**
+     * The RNG array is initialized at frame 13, and is ticked once at the top
+     * of every iteration, so jump straight to the tick before start_frame.
+     *
+     * The assumption is made that we won't check frame numbers that are less
+     * than the number of lag frames at 2f, minus the NUM_POWERUP_CLOUDS, minus
+     * the number of frames between when bro facing intitialization occurs and
+     * end of level. So start_frame should be at minimum this value. Realistically,
+     * start_frame is going to be in the 16000+ range for world 2.
+     */
+    if (start_frame < 13) {
+        start_frame = 13;
+        frame = 13;
+    }
+    if ((Sweep_NumArgs || g_routes) && end_frame > INT_MAX) {
+        fprintf(stderr, "Lag sweeps and routes only scan iterations below %d\n", INT_MAX);
+        exit(1);
+    }
+    if (Sweep_NumArgs) {
+        print_randoms(Random_Pool, sizeof(Random_Pool));
+        Lag_Sweep(start_frame, end_frame);
+        return 0;
+    }
+    if (g_routes) {
+        print_randoms(Random_Pool, sizeof(Random_Pool));
+        Route_Optimize(start_frame, end_frame, g_routes);
+        return 0;
+    }
+
+    if (!Checkpoint_File || !Checkpoint_Load(start_frame, end_frame, &frame, &bits_size)) {
+        if (g_format == OUTPUT_TEXT) {
+            print_randoms(Random_Pool, sizeof(Random_Pool));
+        }
+        Randomize_N(start_frame - 13);
+    }
+    if (Bitset_File) {
+        Bitsets_Open(start_frame, end_frame, bits_size);
+    }
+    if (!Checkpoint_File) {
+        Scan_Range(start_frame, end_frame);
+        frame = end_frame;
+    } else {
+        struct sigaction sa = { .sa_handler = Scan_Signal, .sa_flags = SA_RESETHAND | SA_RESTART };
+
+        // A second Ctrl-C while the checkpoint is saved kills the scan
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+    }
+    while (frame < end_frame) {
+        int64_t stop = (end_frame - frame > CHECKPOINT_FRAMES)? frame + CHECKPOINT_FRAMES: end_frame;
+
+        Scan_Range(frame, stop);
+        Randomize_N(stop - frame);
+        frame = stop;
+        if (frame < end_frame && (Scan_Stop || time(NULL) - saved >= CHECKPOINT_SECONDS)) {
+            Checkpoint_Save(start_frame, end_frame, frame);
+            saved = time(NULL);
+            if (Scan_Stop) {
+                fprintf(stderr, "Stopped at iteration %" PRId64 ", run the same command to resume\n", frame);
+                exit(128 + Scan_Stop);
+            }
+        }
+    }
+
+    Bitsets_Close();
+    Windows_Report();
+    if (Checkpoint_File) {
+        unlink(Checkpoint_File);
+    }
+
+    return 0;
+}
+
+/**
+ * Warm windows
+ *
+ * The windows of every path, found once over the first three periods of
+ * the RNG so any range of iterations can be answered without scanning.
+ * Once the initial pool has been shifted out, at WARM_BASE, the pools repeat
+ * every RNG_PERIOD iterations and so do the windows, so iterations past the
+ * second period are answered from the windows of the second one, which
+ * start after a whole period of periodic pools.
+ */
+#define WARM_BASE       (13 + RNG_BITS)
+#define WARM_FRAMES     (WARM_BASE - 13 + 3 * RNG_PERIOD)
+
+static struct rng_index Warm_Index;
+static struct window_run **Warm_Runs;
+static int *Warm_NumRuns;
+
+/**
+ * @brief Index every pool and find the windows of every path
+ *
+ * The paths have to be compiled, and the RNG jumps and bit-sliced checks
+ * set up.
+ *
+ * @return void
+ */
+static void Warm_Init(void)
+{
+    uint8_t pool[9];
+    uint64_t **bits;
+
+    RNG_Index_Make(&Warm_Index, 1, true);
+    memcpy(pool, Warm_Index.hdr->pool, sizeof(pool));
+    bits = Sliced_Bitsets(pool, 13, 13 + WARM_FRAMES);
+    Warm_Runs = calloc(Paths.npaths, sizeof(*Warm_Runs));
+    Warm_NumRuns = calloc(Paths.npaths, sizeof(*Warm_NumRuns));
+    for (int p = 0; p < Paths.npaths; p++) {
+        Warm_NumRuns[p] = Bitset_Runs(bits[p], 0, WARM_FRAMES, PATH_STRIDE(p), &Warm_Runs[p]);
+        free(bits[p]);
+    }
+    free(bits);
+}
+
+/**
+ * @brief Find the windows of a path in a range of iterations
+ *
+ * A window that is already open at first counts with the good frames it
+ * has left, a window that opens by last counts whole.
+ *
+ * @param p The path
+ * @param first The first iteration of the range
+ * @param last The last iteration of the range
+ * @param min_len Skip windows with fewer good frames than this
+ * @param out Storage for the windows, .first is the iteration of their
+ *        first good frame
+ * @param max The size of out
+ * @return The number of windows, in frame order
+ */
+static int Warm_Windows(int p, int first, int last, int min_len, struct window_run *out, int max)
+{
+    const struct window_run *runs = Warm_Runs[p];
+    int nruns = Warm_NumRuns[p];
+    int stride = PATH_STRIDE(p);
+    int n = 0;
+
+    first = max(first, 13);
+    for (int cur = first; cur <= last && n < max; ) {
+        int off = 0, end = WARM_BASE + RNG_PERIOD;
+        int lo = 0, hi = nruns;
+
+        if (cur >= end) {
+            off = (cur - end) / RNG_PERIOD * RNG_PERIOD;
+            end += RNG_PERIOD + off;
+        }
+        // The first window whose last good frame is not before cur
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (13 + runs[mid].first + (runs[mid].len - 1) * stride + off < cur) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        for (int r = lo; r < nruns && n < max; r++) {
+            int f = 13 + runs[r].first + off;
+            int len = runs[r].len;
+
+            if (f >= end || f > last) {
+                break;
+            }
+            if (f < cur) {
+                // Only the start of the range cuts a window short, past
+                // that it was already counted from the range before
+                if (cur != first) {
+                    continue;
+                }
+                int skip = (cur - f + stride - 1) / stride;
+                f += skip * stride;
+                len -= skip;
+            }
+            if (len >= min_len) {
+                out[n++] = (struct window_run) { .first = f, .len = len };
+            }
+        }
+        cur = end;
+    }
+    return n;
+}
+
+#ifndef SMB3RNG_LIBRARY
+/**
+ * Seed batches
+ *
+ * `-I seeds` runs the window scan for a batch of other starting conditions
+ * of the RNG, resets, other ROM revisions or routes that get to World 2 in
+ * another phase of it, and prints one line per seed. A seed is a Random_Pool
+ * and the iteration it is the pool one tick before, the way the game's
+ * {88 00 ...} is at 13, one per line of the file:
+ *
+ *   <frame>[:<last_frame>] <rng_bytes>     # a range seeds every frame of it
+ *
+ * A batch is at most SEEDS_MAX seeds, counting every frame of its ranges.
+ * Every seed is scanned over the same iterations as the scan would be, but
+ * from its own frame at the earliest.
+ *
+ * Once a seed's pool has been shifted out, RNG_BITS ticks after its frame,
+ * its pools are the game's pools of some other iteration, and so are its
+ * good frames, since the 15 bits the feedback taps make up an LFSR of their
+ * own. So the good frames of one whole period are checked once for every
+ * seed, and a seed only has the frames before that checked on its own,
+ * along with any seed whose taps are all 0, which never joins the period.
+ */
+#define SEEDS_MAX   (1 << 20)   // seeds a batch can have, ranges expanded
+
+/**
+ * A line of the file, the seeds of every frame of it share the pool, and
+ * are numbered from `index` on
+ */
+struct seed_range {
+    int first;
+    int last;
+    uint8_t pool[9];
+    int index;
+};
+
+/**
+ * A seed, the pool one tick before frame
+ */
+struct seed {
+    int frame;
+    const uint8_t *pool;
+};
+
+static const char *Seeds_File;
+static struct seed_range *Seeds;
+static int Seeds_Ranges;
+static int Seeds_Count;     // seeds, every frame of every range
+
+/**
+ * @brief Read the seeds of a batch, see Seed batches
+ *
+ * @param file The seed file
+ * @return void
+ */
+static void Seeds_Load(const char *file)
+{
+    char line[256];
+    int lineno = 0;
+    size_t size = 0;
+    FILE *f = fopen(file, "r");
+
+    if (!f) {
+        fprintf(stderr, "Could not open %s: %s\n", file, strerror(errno));
+        exit(1);
+    }
+    while (fgets(line, sizeof(line), f)) {
+        char *c = line, *end;
+        int64_t first, last;
+        uint8_t pool[9];
+
+        lineno++;
+        line[strcspn(line, "#\r\n")] = '\0';
+        c += strspn(c, " \t");
+        if (!*c) {
+            continue;
+        }
+        errno = 0;
+        first = last = strtoll(c, &end, 10);
+        if (!errno && end != c && *end == ':') {
+            c = end + 1;
+            last = strtoll(c, &end, 10);
+        }
+        if (errno || end == c || (*end != ' ' && *end != '\t') || first < 0 || last < first ||
+            last > INT_MAX - RNG_BITS || !Parse_Pool(end + strspn(end, " \t"), pool)) {
+            fprintf(stderr, "%s:%d: expected <frame>[:<last_frame>] <rng_bytes>\n", file, lineno);
+            exit(1);
+        }
+        if (last - first + 1 > SEEDS_MAX - Seeds_Count) {
+            fprintf(stderr, "%s:%d: a batch is at most %d seeds\n", file, lineno, SEEDS_MAX);
+            exit(1);
+        }
+        if (Seeds_Ranges == size) {
+            size = size? size * 2: 64;
+            Seeds = realloc(Seeds, size * sizeof(*Seeds));
+            if (!Seeds) {
+                fprintf(stderr, "Out of memory\n");
+                exit(1);
+            }
+        }
+        Seeds[Seeds_Ranges] = (struct seed_range) { .first = first, .last = last, .index = Seeds_Count };
+        memcpy(Seeds[Seeds_Ranges++].pool, pool, sizeof(pool));
+        Seeds_Count += last - first + 1;
+    }
+    fclose(f);
+    if (!Seeds_Count) {
+        fprintf(stderr, "%s has no seeds\n", file);
+        exit(1);
+    }
+}
+
+/**
+ * @brief Seed s of the batch
+ */
+static struct seed Seeds_Get(int s)
+{
+    int lo = 0, hi = Seeds_Ranges - 1;
+
+    // The last range numbered from s or before
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+
+        if (Seeds[mid].index <= s) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return (struct seed) { Seeds[lo].first + (s - Seeds[lo].index), Seeds[lo].pool };
+}
+
+/**
+ * The period every seed's good frames come from, and where they are
+ */
+struct seed_job {
+    uint64_t **period;      // the good frames of two periods from WARM_BASE
+    struct rng_index ix;
+    int64_t start_frame;
+    int64_t end_frame;
+    struct window_node *best;   // per seed and path, the longest first window
+    int *ahead;             // per seed, how far ahead of the game's RNG it is, -1 if never
+    int next;
+};
+
+/**
+ * @brief Copy frames of one period of success bitsets, going around it
+ *
+ * @param dst The bitset to copy to, from bit 0
+ * @param period Two periods of bitsets
+ * @param at The bit of the period to start from
+ * @param frames The number of bits
+ * @return void
+ */
+static void Bits_CopyPeriod(uint64_t *dst, const uint64_t *period, int at, int frames)
+{
+    for (int w = 0; w < (frames + 63) / 64; w++, at = (at + 64) % RNG_PERIOD) {
+        int sh = at % 64;
+
+        dst[w] = period[at / 64] >> sh;
+        if (sh) {
+            dst[w] |= period[at / 64 + 1] << (64 - sh);
+        }
+    }
+}
+
+/**
+ * @brief Scan the iterations of one seed
+ *
+ * @param job The batch
+ * @param s The seed
+ * @return void
+ */
+static void Seeds_Scan(struct seed_job *job, int s)
+{
+    const struct seed seed = Seeds_Get(s);
+    int64_t start_frame = max(job->start_frame, (int64_t)seed.frame);
+    int64_t periodic = seed.frame + RNG_BITS;
+    struct scan_windows ws;
+    uint8_t pool[9], before[9];
+    uint64_t *bits[Paths.npaths];
+    int phase = -1;
+
+    memcpy(pool, seed.pool, sizeof(pool));
+    Randomize_Pool_N(pool, RNG_BITS);
+    job->ahead[s] = RNG_Index_Lookup(&job->ix, pool);
+    if (job->ahead[s] >= 0) {
+        // The pool one tick before periodic is the game's one before ahead + 1
+        phase = ((job->ahead[s] + 1 - WARM_BASE) % RNG_PERIOD + RNG_PERIOD) % RNG_PERIOD;
+        job->ahead[s] = ((job->ahead[s] + 1 - periodic) % RNG_PERIOD + RNG_PERIOD) % RNG_PERIOD;
+    }
+
+    Windows_Init(&ws, false);
+    ws.quiet = true;
+    for (int p = 0; p < Paths.npaths; p++) {
+        ws.windows[p].limit = 1;
+        bits[p] = malloc(Bitset_Words(SCAN_CHUNK_FRAMES) * sizeof(uint64_t));
+        if (!bits[p]) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+    memcpy(before, seed.pool, sizeof(before));
+    Randomize_Pool_N(before, start_frame - seed.frame);
+
+    if (phase < 0) {
+        memcpy(pool, before, sizeof(pool));
+        Sliced_Scan(&ws, pool, start_frame, job->end_frame);
+    } else {
+        int64_t chunk = start_frame;
+
+        // The frames before the seed's pool is shifted out are its own
+        if (chunk < min(periodic, job->end_frame)) {
+            int64_t stop = min(periodic, job->end_frame);
+            uint64_t **own;
+
+            memcpy(pool, before, sizeof(pool));
+            own = Sliced_Bitsets(pool, chunk, stop);
+            Windows_AddBitsets(&ws, own, chunk, stop - chunk, before);
+            for (int p = 0; p < Paths.npaths; p++) {
+                free(own[p]);
+            }
+            free(own);
+            chunk = stop;
+        }
+        for (; chunk < job->end_frame; chunk += SCAN_CHUNK_FRAMES) {
+            int frames = min(job->end_frame - chunk, (int64_t)SCAN_CHUNK_FRAMES);
+            int at = (phase + (chunk - periodic) % RNG_PERIOD) % RNG_PERIOD;
+
+            for (int p = 0; p < Paths.npaths; p++) {
+                Bits_CopyPeriod(bits[p], job->period[p], at, frames);
+            }
+            Windows_AddBitsets(&ws, bits, chunk, frames, before);
+        }
+    }
+
+    for (int p = 0; p < Paths.npaths; p++) {
+        struct window_store *st = &ws.windows[p];
+
+        job->best[(size_t)s * Paths.npaths + p] = st->count? st->nodes[0]: (struct window_node) { 0 };
+        free(bits[p]);
+    }
+    Windows_Free(&ws);
+}
+
+static void *Seeds_Worker(void *arg)
+{
+    struct seed_job *job = arg;
+    int s;
+
+    while ((s = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < Seeds_Count) {
+        Seeds_Scan(job, s);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Scan every seed of the batch and print the longest window of
+ * every path for each
+ *
+ * A seed's line is its frame, its pool, how many iterations ahead of the
+ * game's RNG it is or "-" if it never joins it, and then for every path
+ * <path>=<len>@<eol>, the longest window and the end of level frame the
+ * report would print for its first one, or <path>=0 without a window.
+ *
+ * @param start_frame The first iteration to check
+ * @param end_frame The iteration to stop at
+ * @return 0
+ */
+static int Seeds_Run(int64_t start_frame, int64_t end_frame)
+{
+    struct seed_job job = {
+        .start_frame = start_frame,
+        .end_frame = end_frame,
+        .best = calloc((size_t)Seeds_Count * Paths.npaths, sizeof(*job.best)),
+        .ahead = calloc(Seeds_Count, sizeof(int)),
+    };
+    int nthreads = min(g_threads, Seeds_Count);
+    pthread_t threads[nthreads];
+    uint8_t pool[9];
+
+    if (!job.best || !job.ahead) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    RNG_Index_Make(&job.ix, 1, true);
+    memcpy(pool, Random_Pool, sizeof(pool));
+    Randomize_Pool_N(pool, WARM_BASE - 13);
+    job.period = Sliced_Bitsets(pool, WARM_BASE, WARM_BASE + 2 * RNG_PERIOD);
+
+    for (int t = 1; t < nthreads; t++) {
+        if (pthread_create(&threads[t], NULL, Seeds_Worker, &job)) {
+            fprintf(stderr, "pthread_create: %s\n", strerror(errno));
+            exit(1);
+        }
+    }
+    Seeds_Worker(&job);
+    for (int t = 1; t < nthreads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    for (int s = 0; s < Seeds_Count; s++) {
+        struct seed seed = Seeds_Get(s);
+
+        printf("%d", seed.frame);
+        for (int i = 0; i < 9; i++) {
+            printf("%c%02x", i? ' ': '\t', seed.pool[i]);
+        }
+        if (job.ahead[s] < 0) {
+            printf("\t-");
+        } else {
+            printf("\t%d", job.ahead[s]);
+        }
+        for (int p = 0; p < Paths.npaths; p++) {
+            const struct window_node *w = &job.best[(size_t)s * Paths.npaths + p];
+
+            if (w->window_length) {
+                printf("\t%s=%d@%" PRId64, Paths.name[p], w->window_length, w->eol_frame);
+            } else {
+                printf("\t%s=0", Paths.name[p]);
+            }
+        }
+        printf("\n");
+    }
+
+    for (int p = 0; p < Paths.npaths; p++) {
+        free(job.period[p]);
+    }
+    free(job.period);
+    free(job.ix.pools);
+    free(job.ix.map);
+    free(job.best);
+    free(job.ahead);
+    return 0;
+}
+#endif /* SMB3RNG_LIBRARY */
+
+#ifndef SMB3RNG_LIBRARY
+/**
+ * Query server
+ *
+ * `-S socket` keeps the warm windows and answers queries on a Unix socket,
+ * one line per query, for as many clients at once as connect. Every query
+ * is answered with any number of data lines and then one line starting
+ * with "ok" or "err", and a client can send a batch of queries at once:
+ *
+ *   paths
+ *       path <name> <level> <lag> <eol2init> <fort>   for every path
+ *       ok <paths>
+ *   pool <rng_bytes>
+ *       ok <iteration>                  the first iteration with the pool
+ *   windows <path|*> <from_eol> <to_eol> [lag=<frames>] [min=<len>] [max=<count>]
+ *       window <path> <first_eol> <last_eol> <len>
+ *                                       in frame order per path
+ *       ok <windows>
+ *   quit
+ *
+ * so a shell can just `echo "windows * 18000 24000" | socat - UNIX-CONNECT:sock`.
+ * EOL frames are end of level lag frames, the last one of a window is the
+ * one the report prints. The lag defaults to the level's own, and the
+ * minimum window length to the one the report uses, 3 frames for levels
+ * and 2 for forts.
+ */
+#define SERVE_LINE_MAX      1024
+#define SERVE_MAX_WINDOWS   4096
+// The last iteration a query can reach, so Warm_Windows() stays within int
+#define SERVE_MAX_ITERATION (INT_MAX - WARM_FRAMES - 2 * RNG_PERIOD)
+
+struct serve_buf {
+    char *data;
+    size_t len;
+    size_t size;
+};
+
+static void Serve_Printf(struct serve_buf *b, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    for (;;) {
+        va_start(ap, fmt);
+        n = vsnprintf(b->data + b->len, b->size - b->len, fmt, ap);
+        va_end(ap);
+        if (b->len + n < b->size) {
+            break;
+        }
+        b->size = max(2 * b->size, b->len + n + 1);
+        b->data = realloc(b->data, b->size);
+    }
+    b->len += n;
+}
+
+/**
+ * @brief The iterations of a range of EOL frames of a path
+ *
+ * @return The shift from EOL frames to iterations, Path_EOLFrame() the
+ *         other way around
+ */
+static int64_t Serve_Shift(int p, int64_t lag)
+{
+    int lvl = Paths.level[p];
+
+    return NUM_POWERUP_CLOUDS + Paths.eol_to_init_frames[lvl] - (lag < 0? Paths.lag_frames[lvl]: lag);
+}
+
+static void Serve_Windows(char *args, struct serve_buf *out)
+{
+    char *save, *path = strtok_r(args, " \t", &save);
+    char *a = strtok_r(NULL, " \t", &save);
+    char *b = strtok_r(NULL, " \t", &save);
+    int64_t from, to, lag = -1, min_len = -1, count = SERVE_MAX_WINDOWS;
+    int p_first = 0, p_last = Paths.npaths - 1, total = 0;
+    struct window_run *w;
+    char *tok;
+
+    if (!b) {
+        Serve_Printf(out, "err windows needs a path and a range of EOL frames\n");
+        return;
+    }
+    if (strcmp(path, "*")) {
+        if ((p_first = p_last = Paths_FindPath(path)) < 0) {
+            Serve_Printf(out, "err unknown path %s\n", path);
+            return;
+        }
+    }
+    if (!Parse_Number(a, 0, INT_MAX, &from) || !Parse_Number(b, from, INT_MAX, &to)) {
+        Serve_Printf(out, "err expected a range of EOL frames, got %s %s\n", a, b);
+        return;
+    }
+    while ((tok = strtok_r(NULL, " \t", &save))) {
+        if (!(!strncmp(tok, "lag=", 4) && Parse_Number(tok + 4, 0, INT_MAX, &lag)) &&
+            !(!strncmp(tok, "min=", 4) && Parse_Number(tok + 4, 1, INT_MAX, &min_len)) &&
+            !(!strncmp(tok, "max=", 4) && Parse_Number(tok + 4, 0, INT_MAX, &count))) {
+            Serve_Printf(out, "err bad parameter %s\n", tok);
+            return;
+        }
+    }
+    count = min(count, (int64_t)SERVE_MAX_WINDOWS);
+    for (int p = p_first; p <= p_last; p++) {
+        if (to + Serve_Shift(p, lag) > SERVE_MAX_ITERATION) {
+            Serve_Printf(out, "err EOL frames past %" PRId64 " are out of range for %s\n",
+                         SERVE_MAX_ITERATION - Serve_Shift(p, lag), Paths.name[p]);
+            return;
+        }
+    }
+
+    w = malloc(count * sizeof(*w) + 1);
+    for (int p = p_first; p <= p_last; p++) {
+        int64_t shift = Serve_Shift(p, lag);
+        int n = Warm_Windows(p, max(from + shift, (int64_t)0), to + shift,
+                             min_len < 0? PATH_MIN_WINDOW(p): min_len, w, count);
+
+        for (int i = 0; i < n; i++) {
+            int last_good = w[i].first + (w[i].len - 1) * PATH_STRIDE(p);
+            Serve_Printf(out, "window %s %" PRId64 " %" PRId64 " %d\n", Paths.name[p], w[i].first - shift,
+                         last_good - shift, w[i].len);
+        }
+        total += n;
+    }
+    free(w);
+    Serve_Printf(out, "ok %d\n", total);
+}
+
+/**
+ * @brief Answer one query line
+ *
+ * @return false if the client is done
+ */
+static bool Serve_Line(char *line, struct serve_buf *out)
+{
+    char *save, *cmd = strtok_r(line, " \t\r", &save);
+    char *args = strtok_r(NULL, "\r", &save);
+
+    if (!cmd) {
+        return true;
+    }
+    if (!strcmp(cmd, "quit")) {
+        return false;
+    }
+    if (!strcmp(cmd, "paths")) {
+        for (int p = 0; p < Paths.npaths; p++) {
+            int lvl = Paths.level[p];
+            Serve_Printf(out, "path %s %s %d %d %d\n", Paths.name[p], Paths.level_name[lvl],
+                         Paths.lag_frames[lvl], Paths.eol_to_init_frames[lvl], Paths.fort[lvl]);
+        }
+        Serve_Printf(out, "ok %d\n", Paths.npaths);
+    } else if (!strcmp(cmd, "pool")) {
+        uint8_t pool[9];
+        int iteration;
+
+        if (!args || !Parse_Pool(args, pool)) {
+            Serve_Printf(out, "err expected 9 bytes of Random_Pool in hex\n");
+        } else if ((iteration = RNG_Index_Lookup(&Warm_Index, pool)) < 0) {
+            Serve_Printf(out, "err the RNG never reaches the pool\n");
+        } else {
+            Serve_Printf(out, "ok %d\n", iteration);
+        }
+    } else if (!strcmp(cmd, "windows")) {
+        Serve_Windows(args? args: "", out);
+    } else {
+        Serve_Printf(out, "err unknown query %s\n", cmd);
+    }
+    return true;
+}
+
+static bool Serve_Write(int fd, struct serve_buf *out)
+{
+    for (size_t done = 0; done < out->len; ) {
+        ssize_t n = write(fd, out->data + done, out->len - done);
+        if (n < 0 && errno != EINTR) {
+            return false;
+        }
+        done += max(n, 0);
+    }
+    out->len = 0;
+    return true;
+}
+
+/**
+ * @brief Answer the queries of one client
+ *
+ * Every query that arrived in one read is answered in one write, so a
+ * batch costs a single round trip.
+ *
+ * @param arg The client's socket
+ * @return NULL
+ */
+static void *Serve_Client(void *arg)
+{
+    int fd = (intptr_t)arg;
+    char in[SERVE_LINE_MAX];
+    size_t len = 0;
+    struct serve_buf out = { .data = malloc(4096), .size = 4096 };
+    bool open = true;
+
+    while (open) {
+        ssize_t n = read(fd, in + len, sizeof(in) - len);
+        char *line = in, *nl;
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        len += n;
+        while (open && (nl = memchr(line, '\n', in + len - line))) {
+            *nl = '\0';
+            open = Serve_Line(line, &out);
+            line = nl + 1;
+        }
+        len -= line - in;
+        memmove(in, line, len);
+        if (len == sizeof(in)) {
+            Serve_Printf(&out, "err line too long\n");
+            open = false;
+        }
+        if (!Serve_Write(fd, &out)) {
+            break;
+        }
+    }
+    free(out.data);
+    close(fd);
+    return NULL;
+}
+
+/**
+ * @brief Answer queries on a Unix socket until killed
+ *
+ * @param path The socket, replaced if it exists, anything else there is an error
+ * @return Does not return
+ */
+static void Serve(const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    pthread_attr_t attr;
+    struct stat st;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path %s is too long\n", path);
+        exit(1);
+    }
+    strcpy(addr.sun_path, path);
+    if (!lstat(path, &st)) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "%s exists and is not a socket\n", path);
+            exit(1);
+        }
+        unlink(path);
+    }
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 64) < 0) {
+        fprintf(stderr, "Could not listen on %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    // A client that hangs up early must not take the server down
+    signal(SIGPIPE, SIG_IGN);
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    fprintf(stderr, "Listening on %s\n", path);
+
+    for (;;) {
+        pthread_t thread;
+        int client = accept(fd, NULL, NULL);
+
+        if (client < 0) {
+            if (errno != EINTR && errno != ECONNABORTED) {
+                fprintf(stderr, "Could not accept on %s: %s\n", path, strerror(errno));
+                exit(1);
+            }
+            continue;
+        }
+        if (pthread_create(&thread, &attr, Serve_Client, (void *)(intptr_t)client)) {
+            close(client);
+        }
+    }
+}
+#endif /* SMB3RNG_LIBRARY */
+
+#ifdef SMB3RNG_LIBRARY
+/**
+ * Library
+ *
+ * The same scanner behind the API in smb3rng.h, built with
+ * -DSMB3RNG_LIBRARY. Init warms the windows up, so every live pool is a
+ * hash lookup and a binary search away from its windows.
+ */
+#include "smb3rng.h"
+
+static bool Lib_Ready;
+// The pool of the last lookup, the next one is usually a tick after it
+static uint8_t Lib_LastPool[9];
+static int Lib_LastIteration = -1;
+
+int smb3rng_init(const char *spec)
+{
+    jmp_buf jmp;
+
+    if (Lib_Ready) {
+        return 0;
+    }
+    if (setjmp(jmp)) {
+        // Half loaded paths are dropped, a later call starts over
+        Paths_Jmp = NULL;
+        Paths = (struct path_table) { 0 };
+        return -1;
+    }
+    Paths_Jmp = &jmp;
+    if (spec) {
+        Paths_Load(spec);
+    } else {
+        Paths_AddBuiltins();
+    }
+    Compile_Paths();
+    Paths_Jmp = NULL;
+
+    RNG_InitJumps();
+    Sliced_Init();
+    Memo_Init();
+    Warm_Init();
+    Lib_Ready = true;
+    return 0;
+}
+
+const char *smb3rng_error(void)
+{
+    return Paths_ErrorMsg;
+}
+
+int smb3rng_num_paths(void)
+{
+    return Paths.npaths;
+}
+
+const char *smb3rng_path_name(int path)
+{
+    return (path >= 0 && path < Paths.npaths)? Paths.name[path]: NULL;
+}
+
+int smb3rng_find_path(const char *name)
+{
+    return Paths_FindPath(name);
+}
+
+int smb3rng_iteration(const uint8_t *pool)
+{
+    int i = -1;
+
+    if (!Lib_Ready) {
+        return -1;
+    }
+    if (Lib_LastIteration >= 0) {
+        uint8_t next[9];
+
+        memcpy(next, Lib_LastPool, sizeof(next));
+        if (!memcmp(next, pool, sizeof(next))) {
+            return Lib_LastIteration;
+        }
+        Randomize_Pool(next);
+        if (!memcmp(next, pool, sizeof(next))) {
+            i = Lib_LastIteration + 1;
+            if (RNG_Index_Check(&Warm_Index, i - RNG_PERIOD, pool)) {
+                i -= RNG_PERIOD;
+            }
+        }
+    }
+    if (i < 0) {
+        i = RNG_Index_Lookup(&Warm_Index, pool);
+    }
+    if (i >= 0) {
+        memcpy(Lib_LastPool, pool, sizeof(Lib_LastPool));
+        Lib_LastIteration = i;
+    }
+    return i;
+}
+
+int smb3rng_next_windows(int path, const uint8_t *pool, int lag, int min_len,
+                         struct smb3rng_window *out, int max)
+{
+    struct window_run w[SMB3RNG_MAX_WINDOWS];
+    int iteration, n;
+
+    if (path < 0 || path >= Paths.npaths || (iteration = smb3rng_iteration(pool)) < 0) {
+        return -1;
+    }
+    if (lag < 0) {
+        lag = Paths.lag_frames[Paths.level[path]];
+    }
+    // Every window comes around within a period
+    n = Warm_Windows(path, iteration, iteration + 2 * RNG_PERIOD, min_len, w,
+                     min(max, SMB3RNG_MAX_WINDOWS));
+    for (int i = 0; i < n; i++) {
+        out[i] = (struct smb3rng_window) {
+            .eol = w[i].first + lag - NUM_POWERUP_CLOUDS - Paths.eol_to_init_frames[Paths.level[path]],
+            .len = w[i].len,
+            .iteration = w[i].first,
+        };
+    }
+    return n;
+}
+#endif /* SMB3RNG_LIBRARY */
+
+#ifndef SMB3RNG_LIBRARY
+/**
+ * @brief Parse an int option, or print the usage and exit
+ */
+static int Int_Arg(char *prog, const char *arg, int lo)
+{
+    int64_t v;
+
+    if (!Parse_Number(arg, lo, INT_MAX, &v)) {
+        usage(prog);
+        exit(1);
+    }
+    return v;
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    const char *spec = NULL;
+    const char *index_file = NULL;
+    const char *query = NULL;
+    const char *socket_path = NULL;
+    const char *analyze_file = NULL;
+    const char *movie = NULL;
+    int index_stride = 0;
+    int64_t start = 2000;
+    int64_t end = END_ITERATION;
+    int64_t first_mark, last_mark;
+    bool have_end = false;
+    bool print_spec = false;
+    bool order_checks = false;
+
+    if (!isatty(STDOUT_FILENO)) {
+        setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+    }
+    while ((opt = getopt(argc, argv, "A:b:B:C:e:i:I:j:k:L:m:M:o:q:OR:s:PS:t:")) != -1) {
+        switch (opt) {
+        case 'A':
+            analyze_file = optarg;
+            break;
+        case 'b':
+            index_stride = Int_Arg(argv[0], optarg, 1);
+            break;
+        case 'B':
+            Bitset_File = optarg;
+            break;
+        case 'C':
+            Checkpoint_File = optarg;
+            break;
+        case 'e':
+            if (!Parse_Number(optarg, 1, MAX_ITERATION, &end)) {
+                usage(argv[0]);
+                exit(1);
+            }
+            have_end = true;
+            break;
+        case 'i':
+            index_file = optarg;
+            break;
+        case 'I':
+            Seeds_File = optarg;
+            break;
+        case 'j':
+            g_threads = Int_Arg(argv[0], optarg, 1);
+            break;
+        case 'k':
+            g_top_windows = Int_Arg(argv[0], optarg, 0);
+            break;
+        case 'L':
+            Sweep_Args = realloc(Sweep_Args, (Sweep_NumArgs + 1) * sizeof(*Sweep_Args));
+            Sweep_Args[Sweep_NumArgs++] = optarg;
+            break;
+        case 'm':
+            g_min_window = Int_Arg(argv[0], optarg, 1);
+            break;
+        case 'M':
+            movie = optarg;
+            break;
+        case 'o':
+            if (!Output_Parse(optarg, &g_format)) {
+                usage(argv[0]);
+                exit(1);
+            }
+            break;
+        case 'q':
+            query = optarg;
+            break;
+        case 'O':
+            order_checks = true;
+            break;
+        case 'R':
+            g_routes = Int_Arg(argv[0], optarg, 1);
+            break;
+        case 's':
+            spec = optarg;
+            break;
+        case 'P':
+            print_spec = true;
+            break;
+        case 'S':
+            socket_path = optarg;
+            break;
+        case 't':
+            g_stride = Int_Arg(argv[0], optarg, 1);
+            if (g_stride > 2) {
+                usage(argv[0]);
+                exit(1);
+            }
+            break;
+        default:
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+    if (argc - optind > 2 || ((index_stride || query) && !index_file) ||
+        (argc - optind >= 1 && !Parse_Number(argv[optind], 0, MAX_ITERATION, &start)) ||
+        (argc - optind == 2 && strcmp(argv[optind + 1], "v") && strcmp(argv[optind + 1], "verbose"))) {
+        usage(argv[0]);
+        exit(1);
+    }
+    if (argc - optind == 2) {
+        g_verbose = true;
+    }
+    if ((Checkpoint_File || analyze_file) && (Sweep_NumArgs || g_routes || index_file || socket_path || print_spec)) {
+        fprintf(stderr, "-C and -A only work for window scans\n");
+        exit(1);
+    }
+    if (Bitset_File && (analyze_file || g_verbose || Sweep_NumArgs || g_routes || index_file || socket_path)) {
+        fprintf(stderr, "-B only works for window scans that aren't verbose\n");
+        exit(1);
+    }
+    if (Seeds_File && (g_verbose || Checkpoint_File || analyze_file || Bitset_File || Sweep_NumArgs || g_routes ||
+                       index_file || socket_path || print_spec)) {
+        fprintf(stderr, "-I only works for window scans that aren't verbose\n");
+        exit(1);
+    }
+    if (g_format != OUTPUT_TEXT && (g_verbose || Sweep_NumArgs || g_routes || index_file || socket_path ||
+                                    print_spec || Seeds_File)) {
+        fprintf(stderr, "-o only works for window scans that aren't verbose, and -A\n");
+        exit(1);
+    }
+    if (analyze_file && Checkpoint_File) {
+        fprintf(stderr, "-A does not scan, so there is nothing to checkpoint\n");
+        exit(1);
+    }
+
+    if (spec) {
+        Paths_Load(spec);
+    } else {
+        Paths_AddBuiltins();
+    }
+    if (Seeds_File) {
+        Seeds_Load(Seeds_File);
+    }
+    if (movie && Movie_Load(movie, &first_mark, &last_mark)) {
+        if (argc - optind < 1) {
+            start = max(first_mark - MOVIE_SCAN_MARGIN, (int64_t)13);
+        }
+        if (!have_end) {
+            end = min(last_mark + MOVIE_SCAN_MARGIN, MAX_ITERATION);
+        }
+    }
+    if (max(start, 13) >= end) {
+        fprintf(stderr, "The scan ends at iteration %" PRId64 ", before it starts\n", end);
+        exit(1);
+    }
+    if (print_spec) {
+        Paths_Print(stdout);
+        return 0;
+    }
+
+    RNG_InitJumps();
+    Compile_Paths();
+    Sliced_Init();
+    Memo_Init();
+    if (order_checks && Memo_Use) {
+        fprintf(stderr, "The scan is memoised and doesn't use the check order, ignoring -O\n");
+    } else if (order_checks) {
+        Order_Checks(max(start, (int64_t)13));
+        Sliced_Free();
+        Sliced_Init();
+    }
+    Windows_Init(&g_windows, false);
+
+    if (socket_path) {
+        Warm_Init();
+        Serve(socket_path);
+    }
+    if (index_file) {
+        if (index_stride) {
+            RNG_Index_Build(index_file, index_stride);
+            if (!query) {
+                return 0;
+            }
+        }
+        if (RNG_Index_Open(&g_index, index_file) < 0) {
+            fprintf(stderr, "Could not map index %s: %s\n", index_file, strerror(errno));
+            exit(1);
+        }
+    }
+    if (query) {
+        return RNG_Index_Query(query, RNG_INDEX_WINDOWS);
+    }
+    if (analyze_file) {
+        return Bitsets_Analyze(analyze_file);
+    }
+    if (Seeds_File) {
+        return Seeds_Run(max(start, (int64_t)13), end);
     }
 
-    return do_early_hammer(start);
+    return do_early_hammer(start, end);
 }
+#endif /* SMB3RNG_LIBRARY */
@@ -0,0 +1,44 @@
+# The builtin world 2 early hammer paths, as printed by `smb3rngchk -P`.
+# Check them, or an edited copy, with `smb3rngchk -s world2.spec`.
+#
+# level <name> lag=<frames> eol2init=<frames> face2move=<frames> [fort]
+# path <name>
+#     object <objid> <move> ...
+# route <name> <path> <frames> <path> ...
+#
+# objid 2 is the music box and 3 the hammer. A move is the result of moving
+# RIGHT, LEFT, DOWN and UP: N(eeded), F(ail) or I(nvalid).
+# A route's frames are the minimum between the EOL frames of its levels,
+# see `smb3rngchk -R`.
+# The lags can be taken from the subtitles of a movie instead, see
+# `smb3rngchk -M`.
+
+level 2-1 lag=684 eol2init=28 face2move=39
+path 2-1__1
+    object 2 NFII IFFN
+    object 3 IIFN
+path 2-1__2
+    object 2 NFII IFNF
+    object 3 IIFN
+
+level 2-2 lag=769 eol2init=28 face2move=39
+path 2-2__1
+    object 2 FNFI NIII
+    object 3 IIFN
+path 2-2__2
+    object 2 IIFN IFFN
+    object 3 IIFN
+
+level 2-f lag=869 eol2init=28 face2move=102 fort
+path 2-f__1
+    object 2 FNFI NIII FFNI INFF FNII FINF
+    object 3 INFI FNII FFNI INFF FNII FIFN
+path 2-f__3
+    object 2 NFII IFFN FNFI NIII FFNI INFF
+    object 3 INFI FNII FNFI NIII FFNI INFF
+path 2-f__6
+    object 2 IIFN IFFN FNFI NIII FFNI INFF
+    object 3 INFI FNII FNFI NIII FFNI INFF
+
+route __1 2-1__1 1995 2-2__1 2872 2-f__1
+route __2 2-1__2 1995 2-2__2 2872 2-f__1